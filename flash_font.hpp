@@ -0,0 +1,218 @@
+#ifndef ZOAL_FONT_GENERATOR_FLASH_FONT_HPP
+#define ZOAL_FONT_GENERATOR_FLASH_FONT_HPP
+
+#include "types.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zoal {
+    namespace text {
+        // External flash image written by GenFont --flash-page (all values little-endian):
+        //
+        //   0  magic "ZFNT"
+        //   4  u16 page size
+        //   6  u8  y advance
+        //   7  u8  bits per pixel
+        //   8  u16 ranges count
+        //  10  u16 glyphs count
+        //  12  u32 reserved
+        //  16  ranges: u16 start, u16 end, u16 base, u32 descriptor table address
+        //
+        // Every range is one block: it starts on a fresh page with its descriptor
+        // table, followed by its bitmaps, so text in one script keeps hitting the
+        // same pages. Descriptors are 8 bytes (u24 bitmap address, width, height,
+        // x advance, x offset, y offset) and never straddle a page; a bitmap never
+        // crosses a page boundary unless it is larger than a page. One glyph miss
+        // costs one descriptor and one bitmap read.
+        struct flash_layout {
+            static constexpr uint32_t magic = 0x544E465Au;
+            static constexpr uint32_t header_size = 16;
+            static constexpr uint32_t range_size = 10;
+            static constexpr uint32_t descriptor_size = 8;
+            static constexpr uint32_t max_bitmap_address = 1u << 24;
+        };
+
+        // Fixed-RAM LRU of glyphs read from an external flash image through
+        // BlockReader::read(uint32_t address, uint8_t *dst, uint16_t size).
+        template<class BlockReader, size_t Slots = 16, size_t SlotBytes = 64, size_t MaxRanges = 8>
+        class flash_glyph_cache {
+        public:
+            struct slot {
+                uint16_t code;
+                glyph desc;
+                uint8_t bitmap[SlotBytes];
+                uint32_t used;
+                bool valid;
+            };
+
+            bool begin() {
+                uint8_t header[flash_layout::header_size];
+                if (!fetch(0, header, sizeof(header)) || u32(header) != flash_layout::magic) {
+                    return false;
+                }
+
+                y_advance_ = header[6];
+                bpp_ = header[7] > 1 ? header[7] : 1;
+                ranges_count_ = u16(header + 8);
+                glyphs_count_ = u16(header + 10);
+                if (ranges_count_ > MaxRanges) {
+                    return false;
+                }
+
+                for (uint16_t i = 0; i < ranges_count_; i++) {
+                    uint8_t data[flash_layout::range_size];
+                    if (!fetch(flash_layout::header_size + i * flash_layout::range_size, data, sizeof(data))) {
+                        return false;
+                    }
+
+                    ranges_[i].start = u16(data);
+                    ranges_[i].end = u16(data + 2);
+                    ranges_[i].base = u16(data + 4);
+                    descriptors_[i] = u32(data + 6);
+                }
+
+                for (size_t i = 0; i < Slots; i++) {
+                    slots_[i].valid = false;
+                }
+                return true;
+            }
+
+            // Returns nullptr for code points outside the font and for glyphs whose
+            // bitmap does not fit SlotBytes.
+            const slot *get(uint16_t code) {
+                for (size_t i = 0; i < Slots; i++) {
+                    if (slots_[i].valid && slots_[i].code == code) {
+                        hits_++;
+                        slots_[i].used = ++tick_;
+                        return slots_ + i;
+                    }
+                }
+
+                misses_++;
+                int range = range_index(code);
+                if (range < 0 || ranges_[range].base + (code - ranges_[range].start) >= glyphs_count_) {
+                    return nullptr;
+                }
+
+                uint8_t data[flash_layout::descriptor_size];
+                uint32_t address = descriptors_[range] + (code - ranges_[range].start) * flash_layout::descriptor_size;
+                if (!fetch(address, data, sizeof(data))) {
+                    return nullptr;
+                }
+
+                glyph desc{};
+                desc.bitmap_offset = (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16);
+                desc.width = data[3];
+                desc.height = data[4];
+                desc.x_advance = data[5];
+                desc.x_offset = (int8_t) data[6];
+                desc.y_offset = (int8_t) data[7];
+
+                size_t size = ((desc.width * bpp_ + 7) >> 3) * desc.height;
+                if (size > SlotBytes) {
+                    oversized_++;
+                    return nullptr;
+                }
+
+                slot *s = victim();
+                s->valid = false;
+                if (size > 0 && !fetch(desc.bitmap_offset, s->bitmap, (uint16_t) size)) {
+                    return nullptr;
+                }
+
+                s->code = code;
+                s->desc = desc;
+                s->used = ++tick_;
+                s->valid = true;
+                return s;
+            }
+
+            uint8_t y_advance() const {
+                return y_advance_;
+            }
+
+            uint8_t bits_per_pixel() const {
+                return bpp_;
+            }
+
+            uint16_t glyphs_count() const {
+                return glyphs_count_;
+            }
+
+            uint32_t hits() const {
+                return hits_;
+            }
+
+            uint32_t misses() const {
+                return misses_;
+            }
+
+            uint32_t oversized() const {
+                return oversized_;
+            }
+
+            uint32_t reads() const {
+                return reads_;
+            }
+
+            uint32_t bytes_read() const {
+                return bytes_read_;
+            }
+
+        private:
+            static uint16_t u16(const uint8_t *p) {
+                return (uint16_t) (p[0] | (p[1] << 8));
+            }
+
+            static uint32_t u32(const uint8_t *p) {
+                return (uint32_t) u16(p) | ((uint32_t) u16(p + 2) << 16);
+            }
+
+            bool fetch(uint32_t address, uint8_t *dst, uint16_t size) {
+                reads_++;
+                bytes_read_ += size;
+                return BlockReader::read(address, dst, size);
+            }
+
+            int range_index(uint16_t code) const {
+                for (uint16_t i = 0; i < ranges_count_; i++) {
+                    if (ranges_[i].start <= code && code <= ranges_[i].end) {
+                        return i;
+                    }
+                }
+                return -1;
+            }
+
+            slot *victim() {
+                slot *result = slots_;
+                for (size_t i = 0; i < Slots; i++) {
+                    if (!slots_[i].valid) {
+                        return slots_ + i;
+                    }
+
+                    if (slots_[i].used < result->used) {
+                        result = slots_ + i;
+                    }
+                }
+                return result;
+            }
+
+            slot slots_[Slots];
+            unicode_range ranges_[MaxRanges];
+            uint32_t descriptors_[MaxRanges];
+            uint16_t ranges_count_{0};
+            uint16_t glyphs_count_{0};
+            uint8_t y_advance_{0};
+            uint8_t bpp_{1};
+            uint32_t tick_{0};
+            uint32_t hits_{0};
+            uint32_t misses_{0};
+            uint32_t oversized_{0};
+            uint32_t reads_{0};
+            uint32_t bytes_read_{0};
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "flash_font.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+class image_reader {
+public:
+    static bool read(uint32_t address, uint8_t *dst, uint16_t size) {
+        auto &img = image();
+        if (address + size > img.size()) {
+            return false;
+        }
+
+        uint32_t first = address / page_size();
+        uint32_t last = (address + size - 1) / page_size();
+        pages() += last - first + 1;
+        std::copy(img.begin() + address, img.begin() + address + size, dst);
+        return true;
+    }
+
+    static std::vector<uint8_t> &image() {
+        static std::vector<uint8_t> instance;
+        return instance;
+    }
+
+    static uint32_t &pages() {
+        static uint32_t instance = 0;
+        return instance;
+    }
+
+    static uint32_t page_size() {
+        auto &img = image();
+        return img.size() < 6 ? 1 : img[4] | (img[5] << 8);
+    }
+};
+
+static std::vector<uint16_t> decode_utf8(const std::string &text) {
+    std::vector<uint16_t> result;
+    for (size_t i = 0; i < text.size();) {
+        auto c = (uint8_t) text[i];
+        uint32_t code = c;
+        int extra = 0;
+        if (c >= 0xF0) {
+            code = c & 0x07;
+            extra = 3;
+        } else if (c >= 0xE0) {
+            code = c & 0x0F;
+            extra = 2;
+        } else if (c >= 0xC0) {
+            code = c & 0x1F;
+            extra = 1;
+        }
+
+        i++;
+        for (int k = 0; k < extra && i < text.size(); k++, i++) {
+            code = (code << 6) | (text[i] & 0x3F);
+        }
+
+        if (code != '\n' && code != '\r' && code <= 0xFFFF) {
+            result.push_back((uint16_t) code);
+        }
+    }
+    return result;
+}
+
+template<size_t Slots, size_t SlotBytes>
+static void simulate(const std::vector<uint16_t> &trace) {
+    zoal::text::flash_glyph_cache<image_reader, Slots, SlotBytes, 32> cache;
+    image_reader::pages() = 0;
+    if (!cache.begin()) {
+        std::cout << "invalid flash image" << std::endl;
+        return;
+    }
+
+    for (auto code : trace) {
+        cache.get(code);
+    }
+
+    auto total = cache.hits() + cache.misses();
+    std::cout << std::setw(5) << Slots << " x " << std::setw(4) << SlotBytes << " bytes: "
+              << std::fixed << std::setprecision(1) << (total ? 100.0 * cache.hits() / total : 0.0) << "% hits, "
+              << cache.reads() << " reads, " << cache.bytes_read() << " bytes, "
+              << image_reader::pages() << " pages, " << cache.oversized() << " oversized" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        namespace po = boost::program_options;
+        po::options_description desc("Options");
+
+        desc.add_options()
+                ("help,h", "display help")
+                ("image,i", po::value<std::string>(), "flash image written by GenFont --flash-page")
+                ("trace,t", po::value<std::string>(), "UTF-8 text file to render");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        if (!vm.count("image") || !vm.count("trace")) {
+            std::cout << "Missing image or trace argument parameter" << std::endl;
+            return 0;
+        }
+
+        std::ifstream img(vm["image"].as<std::string>(), std::ios::binary);
+        image_reader::image().assign(std::istreambuf_iterator<char>(img), std::istreambuf_iterator<char>());
+
+        std::ifstream txt(vm["trace"].as<std::string>(), std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(txt)), std::istreambuf_iterator<char>());
+        auto trace = decode_utf8(text);
+
+        std::cout << trace.size() << " glyphs in trace, page size " << image_reader::page_size() << std::endl;
+        simulate<8, 128>(trace);
+        simulate<16, 128>(trace);
+        simulate<32, 128>(trace);
+        simulate<64, 128>(trace);
+    } catch (std::exception &exc) {
+        std::cerr << exc.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -1,14 +1,26 @@
 #include "font_generator.h"
+#include "flash_font.hpp"
+#include "lz.h"
+#include "lz_font.hpp"
+#include "pixel_pack.h"
+
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <ft2build.h>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include FT_FREETYPE_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
 
 #include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
@@ -22,29 +34,13 @@ bool font_generator::in_range(FT_ULong value) {
     return false;
 }
 
-int font_generator::rasterize_font() {
-    return 0;
-}
-
-int font_generator::generate_fonts_file() {
-    FT_Library library;
-    FT_Error error = FT_Init_FreeType(&library);
-    if (error) {
+int font_generator::rasterize_font(FT_Face face) {
+    if (raster == nullptr || face == nullptr) {
         return -1;
     }
 
-    FT_Face face;
-    error = FT_New_Face(library, font_path.c_str(), 0, &face);
-    if (error) {
-        FT_Done_FreeType(library);
-        return -1;
-    }
-
-    error = FT_Set_Pixel_Sizes(face, 0, font_size);
-    if (error) {
-        FT_Done_Face(face);
-        FT_Done_FreeType(library);
-        return -1;
+    if (use_stream) {
+        begin_stream();
     }
 
     for (auto &rng : font_ranges) {
@@ -57,7 +53,25 @@ int font_generator::generate_fonts_file() {
 
         auto start = std::stoul(strings[0], nullptr, 16);
         auto end = std::stoul(strings[1], nullptr, 16);
-        make_range(face, start, end);
+        make_range(start, end);
+    }
+
+    if (use_digits) {
+        make_digits();
+    }
+
+    if (use_kern || use_kern_classes) {
+        read_kering(face);
+    }
+
+    if (use_kern_classes && kerning.empty()) {
+        use_kern_classes = false;
+    }
+
+    if (use_kern_classes && !make_kerning_classes()) {
+        std::cout << "falling back to kerning pairs" << std::endl;
+        use_kern_classes = false;
+        use_kern = true;
     }
 
     current_font.y_advance = font_size;
@@ -68,146 +82,729 @@ int font_generator::generate_fonts_file() {
     current_font.glyphs_count = glyphs.size();
     current_font.kerning_pairs = kerning.data();
     current_font.kerning_pairs_count = kerning.size();
+    current_font.bits_per_pixel = bpp;
 
-    generate_src(face);
+    return 0;
+}
 
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
+int font_generator::generate_fonts_file() {
+    std::unique_ptr<rasterizer> local;
+    rasterizer *shared = raster;
+    if (raster == nullptr) {
+        local.reset(new rasterizer());
+        raster = local.get();
+    }
 
+    FT_Face face = raster->face(font_path, font_size);
+    if (rasterize_font(face) != 0) {
+        raster = shared;
+        return -1;
+    }
+
+    if (use_stream) {
+        end_stream(face);
+    } else if (use_split) {
+        generate_split_src(face);
+    } else if (flash_page > 0) {
+        if (!generate_flash_image()) {
+            raster = shared;
+            return -1;
+        }
+    } else {
+        generate_src(face);
+    }
+
+    raster = shared;
     return 0;
 }
 
-void font_generator::make_range(FT_Face face, FT_ULong range_from, FT_ULong range_to) {
+void font_generator::make_range(FT_ULong range_from, FT_ULong range_to) {
     zoal::text::unicode_range r;
     r.start = range_from;
     r.end = range_to;
-    r.base = glyphs.size();
+    r.base = glyphs_base + glyphs.size();
     ranges.push_back(r);
 
-    FT_GlyphSlot slot = face->glyph;
+    rendered_glyph rg{};
     for (FT_ULong code = range_from; code <= range_to; code++) {
-        FT_UInt glyph_index = FT_Get_Char_Index(face, code);
-        FT_Error error = FT_Load_Glyph(face, glyph_index, FT_LOAD_DEFAULT);
-        if (error) {
+        if (!raster->render(font_path, font_size, code, bpp > 1 ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_MONO, rg)) {
             continue;
         }
+        create_bitmap_glyph(rg);
 
-        error = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_MONO);
-        if (error) {
+        if (use_stream && buffer.size() >= stream_window) {
+            flush_stream();
+        }
+    }
+
+    if (use_stream) {
+        flush_stream();
+    }
+}
+
+std::string font_generator::output_path(const char *ext) const {
+    return "../" + font_name + ext;
+}
+
+// Renders "0123456789.-:%" into cells of one common advance and height, stored
+// contiguously in SH1106 page order so a counter can be redrawn by copying bytes.
+void font_generator::make_digits() {
+    static const char chars[] = "0123456789.-:%";
+    const int count = sizeof(chars) - 1;
+
+    std::vector<std::vector<uint8_t>> pixels(count);
+    std::vector<int> lefts(count, 0), tops(count, 0), widths(count, 0), heights(count, 0), advances(count, 0);
+    int advance = 0;
+    int top = 0x7FFF;
+    int bottom = -0x7FFF;
+    for (int i = 0; i < count; i++) {
+        rendered_glyph rg{};
+        if (!raster->render(font_path, font_size, (FT_ULong) chars[i], FT_RENDER_MODE_MONO, rg)) {
             continue;
         }
-        create_bitmap_glyph(slot);
+
+        lefts[i] = rg.left;
+        tops[i] = -rg.top;
+        widths[i] = rg.width;
+        heights[i] = rg.rows;
+        advances[i] = rg.advance;
+        pixels[i].resize(rg.width * rg.rows);
+        for (int y = 0; y < rg.rows; y++) {
+            for (int x = 0; x < rg.width; x++) {
+                pixels[i][y * rg.width + x] = (rg.buffer[rg.pitch * y + (x >> 3)] >> (7 - (x & 7))) & 1;
+            }
+        }
+
+        advance = std::max(advance, std::max(advances[i], lefts[i] + widths[i]));
+        if (heights[i] > 0) {
+            top = std::min(top, tops[i]);
+            bottom = std::max(bottom, tops[i] + heights[i]);
+        }
+    }
+
+    if (bottom < top) {
+        top = bottom = 0;
+    }
+
+    const int pages = (bottom - top + 7) >> 3;
+    digits_buffer.assign(count * pages * advance, 0);
+    for (int i = 0; i < count; i++) {
+        auto cell = digits_buffer.data() + i * pages * advance;
+        int dx = lefts[i] + (advance - advances[i]) / 2;
+        int dy = tops[i] - top;
+        for (int y = 0; y < heights[i]; y++) {
+            for (int x = 0; x < widths[i]; x++) {
+                int cx = dx + x;
+                int cy = dy + y;
+                if (pixels[i][y * widths[i] + x] && cx >= 0 && cx < advance) {
+                    cell[(cy >> 3) * advance + cx] |= 1 << (cy & 7);
+                }
+            }
+        }
+    }
+
+    digits.advance = advance;
+    digits.pages = pages;
+    digits.y_offset = (int8_t) top;
+    digits.bitmap = digits_buffer.data();
+}
+
+void font_generator::generate_digits(std::ostream &fs) {
+    std::string progmem = use_progmem ? " PROGMEM" : "";
+    fs << std::endl
+       << "static const uint8_t " << font_name << "_digits_bitmap[]" << progmem << " = {";
+    fs << std::hex;
+    for (size_t i = 0; i < digits_buffer.size(); i++) {
+        if (i % 16 == 0) {
+            fs << std::endl;
+        }
+
+        fs << "0x" << std::setfill('0') << std::setw(2) << std::right << static_cast<int>(digits_buffer[i]) << ", ";
     }
+    fs << "0x00 };" << std::endl
+       << std::endl;
+
+    fs << "const zoal::text::digit_strip " << font_name << "_digits{";
+    fs << std::dec << (int) digits.advance << ", " << (int) digits.pages << ", " << (int) digits.y_offset << ", ";
+    fs << font_name << "_digits_bitmap};" << std::endl;
 }
 
 void font_generator::generate_src(FT_Face face) {
     std::fstream fs;
-    std::string cpp_file = font_name;
-    cpp_file = "../" + cpp_file + ".cpp";
+    fs.open(output_path(".cpp"), std::fstream::out);
+    write_src(fs, face);
+    fs.close();
+
+    generate_header();
+
+    if (use_lz) {
+        size_t raw = glyphs.size() * zoal::text::packed_glyph_size + buffer.size();
+        std::cout << "lz: " << raw << " -> " << lz_buffer.size() << " bytes (" << std::fixed << std::setprecision(1)
+                  << (raw ? 100.0 * lz_buffer.size() / raw : 0.0) << "%), host decode " << lz_decode_us << " us" << std::endl;
+    }
+}
 
-    fs.open(cpp_file, std::fstream::out);
+void font_generator::write_src(std::ostream &fs, FT_Face face) {
     fs << "#include \"" << font_name << ".hpp\"" << std::endl;
     if (use_progmem) {
         fs << "#include <avr/pgmspace.h>" << std::endl;
     }
 
     fs << std::endl;
+    if (rotation != 0) {
+        fs << "// glyphs are rotated " << std::dec << rotation << " degrees clockwise" << std::endl
+           << std::endl;
+    }
 
-    generate_bitmap(fs);
-    generate_glyphs(fs);
+    if (use_lz) {
+        generate_lz(fs);
+    } else {
+        generate_bitmap(fs);
+        generate_glyphs(fs);
+    }
     generate_ranges(fs);
-    if (use_kern) {
+    if (use_kern_classes) {
+        gen_kerning_classes(fs);
+    } else if (use_kern) {
         gen_kerning(fs, face);
     }
     generate_font(fs);
+    if (use_digits) {
+        generate_digits(fs);
+    }
+}
 
+void font_generator::generate_header() {
+    std::fstream fs;
+    fs.open(output_path(".hpp"), std::fstream::out);
+    write_header(fs);
     fs.close();
+}
+
+void font_generator::write_header(std::ostream &fs) const {
+    std::string def_name = font_name;
+    std::transform(def_name.begin(), def_name.end(), def_name.begin(), ::toupper);
+
+    fs << "#ifndef " << def_name << std::endl;
+    fs << "#define " << def_name << std::endl;
+    fs << "#include <zoal/text/types.hpp>" << std::endl;
+    write_type_extensions(fs);
+    if (use_lz) {
+        fs << "extern const zoal::text::packed_font " << font_name << ";" << std::endl;
+    } else {
+        fs << "extern const zoal::text::font " << font_name << ";" << std::endl;
+    }
+    if (use_digits) {
+        fs << "extern const zoal::text::digit_strip " << font_name << "_digits;" << std::endl;
+    }
+    if (use_kern_classes) {
+        fs << "extern const zoal::text::kerning_classes " << font_name << "_kerning_classes;" << std::endl;
+    }
+    fs << "#endif" << std::endl;
+}
+
+// Stock zoal has none of the types added by this generator (see types.hpp), so
+// the header brings along the definitions it needs, guarded like in types.hpp.
+void font_generator::write_type_extensions(std::ostream &fs) const {
+    if (bpp > 1) {
+        fs << "#ifndef ZOAL_TEXT_FONT_BITS_PER_PIXEL" << std::endl
+           << "#error \"antialiased fonts need zoal::text::font::bits_per_pixel (types.hpp of zoal_font_generator)\"" << std::endl
+           << "#endif" << std::endl;
+    }
+
+    if (use_digits) {
+        fs << "#ifndef ZOAL_TEXT_DIGIT_STRIP" << std::endl
+           << "#define ZOAL_TEXT_DIGIT_STRIP" << std::endl
+           << "namespace zoal { namespace text {" << std::endl
+           << "    typedef struct {" << std::endl
+           << "        uint8_t advance;" << std::endl
+           << "        uint8_t pages;" << std::endl
+           << "        int8_t y_offset;" << std::endl
+           << "        const uint8_t *bitmap;" << std::endl
+           << "    } digit_strip;" << std::endl
+           << "}}" << std::endl
+           << "#endif" << std::endl;
+    }
+
+    if (use_kern_classes) {
+        fs << "#ifndef ZOAL_TEXT_KERNING_CLASSES" << std::endl
+           << "#define ZOAL_TEXT_KERNING_CLASSES" << std::endl
+           << "namespace zoal { namespace text {" << std::endl
+           << "    typedef struct {" << std::endl
+           << "        const uint8_t *left;" << std::endl
+           << "        const uint8_t *right;" << std::endl
+           << "        const int8_t *matrix;" << std::endl
+           << "        uint8_t left_count;" << std::endl
+           << "        uint8_t right_count;" << std::endl
+           << "    } kerning_classes;" << std::endl
+           << "}}" << std::endl
+           << "#endif" << std::endl;
+    }
+
+    if (use_lz) {
+        fs << "#ifndef ZOAL_TEXT_PACKED_FONT" << std::endl
+           << "#define ZOAL_TEXT_PACKED_FONT" << std::endl
+           << "namespace zoal { namespace text {" << std::endl
+           << "    typedef struct {" << std::endl
+           << "        uint8_t y_advance;" << std::endl
+           << "        uint8_t bits_per_pixel;" << std::endl
+           << "        const uint8_t *data;" << std::endl
+           << "        uint32_t data_size;" << std::endl
+           << "        uint32_t bitmap_size;" << std::endl
+           << "        uint16_t glyphs_count;" << std::endl
+           << "        const unicode_range *ranges;" << std::endl
+           << "        uint16_t ranges_count;" << std::endl
+           << "        const kerning_pair *kerning_pairs;" << std::endl
+           << "        uint16_t kerning_pairs_count;" << std::endl
+           << "    } packed_font;" << std::endl
+           << "}}" << std::endl
+           << "#endif" << std::endl;
+    }
+}
+
+std::string font_generator::part_name(const zoal::text::unicode_range &r) const {
+    std::stringstream ss;
+    ss << font_name << "_" << std::hex << std::setfill('0') << std::setw(4) << r.start << "_" << std::setw(4) << r.end;
+    return ss.str();
+}
+
+// Split mode writes every unicode range into its own translation unit holding a
+// self-contained font. There is no central table: the firmware lists the parts it
+// uses (see font_parts.hpp), so --gc-sections drops every part nobody refers to.
+void font_generator::generate_split_src(FT_Face face) {
+    std::fstream fs;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        auto &r = ranges[i];
+        size_t first = r.base;
+        size_t last = i + 1 < ranges.size() ? ranges[i + 1].base : glyphs.size();
+        uint32_t bitmap_from = first < glyphs.size() ? glyphs[first].bitmap_offset : buffer.size();
+        uint32_t bitmap_to = last < glyphs.size() ? glyphs[last].bitmap_offset : buffer.size();
+
+        font_generator part;
+        part.font_name = part_name(r);
+        part.font_size = font_size;
+        part.use_progmem = use_progmem;
+        part.use_kern = use_kern;
+        part.bpp = bpp;
+        part.buffer.assign(buffer.begin() + bitmap_from, buffer.begin() + bitmap_to);
+        part.ranges.push_back({r.start, r.end, 0});
+        for (size_t k = first; k < last; k++) {
+            auto g = glyphs[k];
+            g.bitmap_offset -= bitmap_from;
+            part.glyphs.push_back(g);
+        }
+        for (auto &kp : kerning) {
+            if (r.start <= kp.first && kp.first <= r.end) {
+                part.kerning.push_back(kp);
+            }
+        }
+
+        fs.open(part.output_path(".cpp"), std::fstream::out);
+        fs << "#include \"" << font_name << ".hpp\"" << std::endl;
+        if (use_progmem) {
+            fs << "#include <avr/pgmspace.h>" << std::endl;
+        }
+
+        fs << std::endl;
+
+        part.generate_bitmap(fs);
+        part.generate_glyphs(fs);
+        part.generate_ranges(fs);
+        if (use_kern) {
+            part.gen_kerning(fs, face);
+        }
+        part.generate_font(fs);
+        fs.close();
+    }
 
     std::string def_name = font_name;
-    std::string str = "Hello World";
     std::transform(def_name.begin(), def_name.end(), def_name.begin(), ::toupper);
 
-    std::string hpp_file = font_name;
-    hpp_file = "../" + hpp_file + ".hpp";
-    fs.open(hpp_file, std::fstream::out);
+    fs.open(output_path(".hpp"), std::fstream::out);
     fs << "#ifndef " << def_name << std::endl;
     fs << "#define " << def_name << std::endl;
     fs << "#include <zoal/text/types.hpp>" << std::endl;
-    fs << "extern const zoal::text::font " << font_name << ";" << std::endl;
+    write_type_extensions(fs);
+    if (!ranges.empty()) {
+        fs << "// One font per unicode range; list the parts you use, e.g." << std::endl;
+        fs << "// const zoal::text::font *const parts[] = {&" << part_name(ranges.front()) << "};" << std::endl;
+    }
+    for (auto &r : ranges) {
+        fs << "extern const zoal::text::font " << part_name(r) << ";" << std::endl;
+    }
     fs << "#endif" << std::endl;
     fs.close();
 }
 
-void font_generator::create_bitmap_glyph(FT_GlyphSlot slot) {
-    FT_Bitmap &bitmap = slot->bitmap;
+bool font_generator::generate_flash_image() {
+    std::ostringstream image;
+    if (!write_flash_image(image)) {
+        return false;
+    }
+
+    std::fstream fs;
+    fs.open(output_path(".bin"), std::fstream::out | std::fstream::binary);
+    fs << image.str();
+    fs.close();
+    return true;
+}
+
+// Lays the font out for external flash (see flash_font.hpp): every range starts
+// on a page boundary with its descriptor table, followed by its bitmaps, so a
+// script's descriptors and bitmaps share pages. No bitmap crosses a page unless
+// it is larger than one.
+bool font_generator::write_flash_image(std::ostream &fs) {
+    using layout = zoal::text::flash_layout;
+    std::vector<uint8_t> image;
+    auto put8 = [&image](uint32_t v) { image.push_back(v & 0xFF); };
+    auto put16 = [&put8](uint32_t v) { put8(v); put8(v >> 8); };
+    auto put32 = [&put16](uint32_t v) { put16(v); put16(v >> 16); };
+    auto align = [&image, this]() { image.resize((image.size() + flash_page - 1) / flash_page * flash_page, 0xFF); };
+
+    put32(layout::magic);
+    put16(flash_page);
+    put8(font_size);
+    put8(bpp);
+    put16(ranges.size());
+    put16(glyphs.size());
+    put32(0);
+    for (auto &r : ranges) {
+        put16(r.start);
+        put16(r.end);
+        put16(r.base);
+        put32(0);
+    }
+
+    size_t padding = 0;
+    size_t largest = 0;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        size_t first = ranges[i].base;
+        size_t last = i + 1 < ranges.size() ? ranges[i + 1].base : glyphs.size();
+
+        align();
+        uint32_t descriptors = image.size();
+        auto entry = image.begin() + layout::header_size + i * layout::range_size + 6;
+        entry[0] = descriptors & 0xFF;
+        entry[1] = (descriptors >> 8) & 0xFF;
+        entry[2] = (descriptors >> 16) & 0xFF;
+        entry[3] = (descriptors >> 24) & 0xFF;
+        image.resize(descriptors + (last - first) * layout::descriptor_size, 0xFF);
+
+        for (size_t k = first; k < last; k++) {
+            auto &g = glyphs[k];
+            size_t size = ((g.width * bpp + 7) >> 3) * g.height;
+            size_t page_left = flash_page - image.size() % flash_page;
+            if (size > page_left) {
+                padding += page_left;
+                align();
+            }
+
+            uint32_t address = image.size();
+            if (address >= layout::max_bitmap_address) {
+                std::cerr << "flash image: bitmap of U+" << std::hex << (ranges[i].start + (k - first)) << std::dec
+                          << " is past the 16 MiB reach of a descriptor" << std::endl;
+                return false;
+            }
+
+            image.insert(image.end(), buffer.begin() + g.bitmap_offset, buffer.begin() + g.bitmap_offset + size);
+            largest = size > largest ? size : largest;
+
+            auto d = image.begin() + descriptors + (k - first) * layout::descriptor_size;
+            d[0] = address & 0xFF;
+            d[1] = (address >> 8) & 0xFF;
+            d[2] = (address >> 16) & 0xFF;
+            d[3] = g.width;
+            d[4] = g.height;
+            d[5] = g.x_advance;
+            d[6] = (uint8_t) g.x_offset;
+            d[7] = (uint8_t) g.y_offset;
+        }
+    }
+
+    fs.write(reinterpret_cast<const char *>(image.data()), image.size());
+
+    std::cout << "flash image: " << image.size() << " bytes, " << (image.size() + flash_page - 1) / flash_page << " pages of "
+              << flash_page << ", " << padding << " bytes of glyph padding, largest bitmap " << largest << " bytes" << std::endl;
+    return true;
+}
+
+// Streaming mode keeps at most stream_window bytes of bitmap data in memory:
+// bitmap bytes go straight to the .cpp file, glyph descriptors to a temporary
+// file that is appended once the bitmap array is closed.
+void font_generator::begin_stream() {
+    bitmap_base = 0;
+    glyphs_base = 0;
+    stream_src.open(output_path(".cpp"), std::fstream::out);
+    stream_glyphs.open(output_path(".glyphs.tmp"), std::fstream::in | std::fstream::out | std::fstream::trunc);
+
+    stream_src << "#include \"" << font_name << ".hpp\"" << std::endl;
+    if (use_progmem) {
+        stream_src << "#include <avr/pgmspace.h>" << std::endl;
+    }
+
+    std::string progmem = use_progmem ? " PROGMEM" : "";
+    stream_src << std::endl;
+    stream_src << "const uint8_t " << font_name << "_bitmap[]" << progmem << " = {";
+}
+
+void font_generator::flush_stream() {
+    write_bitmap_bytes(stream_src);
+    for (auto &g : glyphs) {
+        write_glyph(stream_glyphs, g);
+        stream_glyphs << "," << std::endl;
+    }
+
+    bitmap_base += buffer.size();
+    glyphs_base += glyphs.size();
+    buffer.clear();
+    glyphs.clear();
+}
+
+void font_generator::end_stream(FT_Face face) {
+    flush_stream();
+    stream_src << "0x00 };" << std::endl
+               << std::endl;
+
+    std::string progmem = use_progmem ? " PROGMEM" : "";
+    stream_src << "static const zoal::text::glyph " << font_name << "_glyphs[]" << progmem << " = {" << std::endl;
+    stream_glyphs.seekg(0);
+    if (glyphs_base > 0) {
+        stream_src << stream_glyphs.rdbuf();
+    }
+    stream_src << "};" << std::endl
+               << std::endl;
+    stream_glyphs.close();
+    std::remove(output_path(".glyphs.tmp").c_str());
+
+    generate_ranges(stream_src);
+    if (use_kern_classes) {
+        gen_kerning_classes(stream_src);
+    } else if (use_kern) {
+        gen_kerning(stream_src, face);
+    }
+    generate_font(stream_src);
+    if (use_digits) {
+        generate_digits(stream_src);
+    }
+    stream_src.close();
+
+    generate_header();
+}
+
+void font_generator::create_bitmap_glyph(const rendered_glyph &rg) {
     zoal::text::glyph g{};
-    g.bitmap_offset = buffer.size();
-    g.x_offset = (int8_t) slot->bitmap_left;
-    g.y_offset = (int8_t) (-slot->bitmap_top);
-    g.width = bitmap.width;
-    g.height = bitmap.rows;
-    g.x_advance = slot->advance.x >> 6;
+    g.bitmap_offset = bitmap_base + buffer.size();
+    g.x_offset = (int8_t) rg.left;
+    g.y_offset = (int8_t) (-rg.top);
+    g.width = rg.width;
+    g.height = rg.rows;
+    g.x_advance = rg.advance;
     glyphs.push_back(g);
 
-    auto bytes = ((bitmap.width + 7) >> 3);
-#if 0
-    uint8_t glyph_row[32];
-    char str[256];
-    for (int y = 0; y < bitmap.rows; y++) {
-        uint8_t *row = bitmap.buffer + bitmap.pitch * y;
-        memset(str, 0, sizeof(str));
-        memset(glyph_row, 0, sizeof(glyph_row));
-        int index = 0;
-        for (int k = 0; k < bitmap.width; k++) {
-            uint8_t pixel = row[k];
-            int bt = k / 8;
-            int offset = 7 - k % 8;
-            glyph_row[bt] |= (pixel < 100 ? 0 : 1) << offset;
+    if (bpp == 1 && rotation == 0) {
+        auto bytes = ((rg.width + 7) >> 3);
+        for (int y = 0; y < rg.rows; y++) {
+            auto row = rg.buffer + rg.pitch * y;
+            for (int k = 0; k < bytes; k++) {
+                buffer.push_back(row[k]);
+            }
+        }
+        return;
+    }
+
+    pack_glyph(glyphs.back(), rg);
+}
+
+// Rotates the glyph clockwise so a renderer with the matching orientation can
+// copy it straight into the framebuffer of a rotated panel, then quantizes it to
+// bpp bits per pixel. Offsets are moved into the panel coordinates; x_advance keeps
+// meaning "advance along the text flow".
+void font_generator::pack_glyph(zoal::text::glyph &g, const rendered_glyph &rg) {
+    const int w = rg.width;
+    const int h = rg.rows;
+    const bool mono = bpp == 1;
+    auto src = [&rg, mono](int x, int y) {
+        if (mono) {
+            return (rg.buffer[rg.pitch * y + (x >> 3)] >> (7 - (x & 7))) & 1 ? 255 : 0;
+        }
+        return (int) rg.buffer[rg.pitch * y + x];
+    };
+
+    int rw = w;
+    int rh = h;
+    int x_offset = g.x_offset;
+    int y_offset = g.y_offset;
+    switch (rotation) {
+        case 90:
+            rw = h;
+            rh = w;
+            x_offset = -(g.y_offset + h - 1);
+            y_offset = g.x_offset;
+            break;
+        case 180:
+            x_offset = -(g.x_offset + w - 1);
+            y_offset = -(g.y_offset + h - 1);
+            break;
+        case 270:
+            rw = h;
+            rh = w;
+            x_offset = g.y_offset;
+            y_offset = -(g.x_offset + w - 1);
+            break;
+        default:
+            break;
+    }
+
+    g.width = rw;
+    g.height = rh;
+    g.x_offset = (int8_t) x_offset;
+    g.y_offset = (int8_t) y_offset;
+
+    std::vector<uint8_t> row((rw * bpp + 7) >> 3);
+    if (!mono && rotation == 0) {
+        for (int y = 0; y < rh; y++) {
+            pack_row(rg.buffer + rg.pitch * y, rw, bpp, dither_row(y, use_dither), row.data());
+            buffer.insert(buffer.end(), row.begin(), row.end());
+        }
+        return;
+    }
 
-            str[index++] = pixel < 50 ? ' ' : 'X';
+    std::vector<uint8_t> pixels(rw);
+    for (int y = 0; y < rh; y++) {
+        for (int x = 0; x < rw; x++) {
+            int value;
+            switch (rotation) {
+                case 90:
+                    value = src(y, h - 1 - x);
+                    break;
+                case 180:
+                    value = src(w - 1 - x, h - 1 - y);
+                    break;
+                case 270:
+                    value = src(w - 1 - y, x);
+                    break;
+                default:
+                    value = src(x, y);
+                    break;
+            }
+            pixels[x] = value;
         }
-        buffer.insert(buffer.end(), glyph_row, glyph_row + bytes);
+        pack_row(pixels.data(), rw, bpp, dither_row(y, use_dither), row.data());
+        buffer.insert(buffer.end(), row.begin(), row.end());
+    }
+}
+
+class host_reader {
+public:
+    template<class T>
+    static inline const T &read_mem(const void *ptr) {
+        return *reinterpret_cast<const T *>(ptr);
+    }
+};
+
+// Compresses packed glyph descriptors followed by the bitmap (see packed_font),
+// then decodes the result the way the device does to check it and time it.
+void font_generator::pack_lz() {
+    std::vector<uint8_t> payload;
+    for (auto &g : glyphs) {
+        payload.push_back(g.bitmap_offset & 0xFF);
+        payload.push_back((g.bitmap_offset >> 8) & 0xFF);
+        payload.push_back((g.bitmap_offset >> 16) & 0xFF);
+        payload.push_back((g.bitmap_offset >> 24) & 0xFF);
+        payload.push_back(g.width);
+        payload.push_back(g.height);
+        payload.push_back(g.x_advance);
+        payload.push_back((uint8_t) g.x_offset);
+        payload.push_back((uint8_t) g.y_offset);
+    }
+    payload.insert(payload.end(), buffer.begin(), buffer.end());
+    lz_buffer = lz_compress(payload);
+
+    zoal::text::packed_font packed{};
+    packed.data = lz_buffer.data();
+    packed.data_size = lz_buffer.size();
+    packed.bitmap_size = buffer.size();
+    packed.glyphs_count = glyphs.size();
+
+    const int rounds = 16;
+    const size_t ram_size = zoal::text::unpacked_size(packed);
+    std::vector<zoal::text::glyph> ram(ram_size / sizeof(zoal::text::glyph) + 1);
+    zoal::text::font unpacked{};
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        if (!zoal::text::unpack_font<host_reader>(packed, ram.data(), ram_size, unpacked)) {
+            throw std::runtime_error("lz round trip failed");
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    lz_decode_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / rounds;
+
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        auto &a = glyphs[i];
+        auto &b = unpacked.glyphs[i];
+        if (a.bitmap_offset != b.bitmap_offset || a.width != b.width || a.height != b.height || a.x_advance != b.x_advance
+            || a.x_offset != b.x_offset || a.y_offset != b.y_offset) {
+            throw std::runtime_error("lz round trip failed");
+        }
+    }
+    if (!std::equal(buffer.begin(), buffer.end(), unpacked.bitmap)) {
+        throw std::runtime_error("lz round trip failed");
     }
-#else
-    for (int y = 0; y < bitmap.rows; y++) {
-        auto row = bitmap.buffer + bitmap.pitch * y;
-        for (int k = 0; k < bytes; k++) {
-            buffer.push_back(row[k]);
+}
+
+void font_generator::generate_lz(std::ostream &fs) {
+    pack_lz();
+
+    std::string progmem = use_progmem ? " PROGMEM" : "";
+    fs << "static const uint8_t " << font_name << "_lz[]" << progmem << " = {";
+    fs << std::hex;
+    for (size_t i = 0; i < lz_buffer.size(); i++) {
+        if (i % 16 == 0) {
+            fs << std::endl;
         }
+
+        fs << "0x" << std::setfill('0') << std::setw(2) << std::right << static_cast<int>(lz_buffer[i]) << ", ";
     }
-#endif
+    fs << "0x00 };" << std::endl
+       << std::endl;
 }
 
-void font_generator::generate_bitmap(std::fstream &fs) {
+void font_generator::generate_bitmap(std::ostream &fs) {
     std::string progmem = use_progmem ? " PROGMEM" : "";
     fs << "const uint8_t " << font_name << "_bitmap[]" << progmem << " = {";
+    write_bitmap_bytes(fs);
+    fs << "0x00 };" << std::endl
+       << std::endl;
+}
 
+void font_generator::write_bitmap_bytes(std::ostream &fs) {
     auto size = buffer.size();
     auto ptr = buffer.data();
     fs << std::hex;
-    for (size_t i = 0; i < size; i++) {
+    for (size_t i = bitmap_base; i < bitmap_base + size; i++) {
         if (i % 16 == 0) {
             fs << std::endl;
         }
 
         fs << "0x" << std::setfill('0') << std::setw(2) << std::right << static_cast<int>(*ptr++) << ", ";
     }
-    fs << "0x00 };" << std::endl
-       << std::endl;
 }
 
-void font_generator::generate_glyphs(std::fstream &fs) {
+void font_generator::write_glyph(std::ostream &fs, const zoal::text::glyph &g) {
+    fs << "{ 0x" << std::hex << (int) g.bitmap_offset;
+    fs << ", " << std::dec << (int) g.width;
+    fs << ", " << std::dec << (int) g.height;
+    fs << ", " << std::dec << (int) g.x_advance;
+    fs << ", " << std::dec << (int) g.x_offset;
+    fs << ", " << std::dec << (int) g.y_offset << "}";
+}
+
+void font_generator::generate_glyphs(std::ostream &fs) {
     auto size = glyphs.size();
-    auto g = glyphs.data();
     std::string progmem = use_progmem ? " PROGMEM" : "";
     fs << "static const zoal::text::glyph " << font_name << "_glyphs[]" << progmem << " = {" << std::endl;
-    for (size_t i = 0; i < size; i++, g++) {
-        fs << "{ 0x" << std::hex << (int) g->bitmap_offset;
-        fs << ", " << std::dec << (int) g->width;
-        fs << ", " << std::dec << (int) g->height;
-        fs << ", " << std::dec << (int) g->x_advance;
-        fs << ", " << std::dec << (int) g->x_offset;
-        fs << ", " << std::dec << (int) g->y_offset << "}";
+    for (size_t i = 0; i < size; i++) {
+        write_glyph(fs, glyphs[i]);
 
         if (i + 1 < size) {
             fs << "," << std::endl;
@@ -220,7 +817,7 @@ void font_generator::generate_glyphs(std::fstream &fs) {
        << std::endl;
 }
 
-void font_generator::generate_ranges(std::fstream &fs) {
+void font_generator::generate_ranges(std::ostream &fs) {
     fs << "static const zoal::text::unicode_range " << font_name << "_ranges[] = {" << std::endl;
 
     auto size = ranges.size();
@@ -237,50 +834,217 @@ void font_generator::generate_ranges(std::fstream &fs) {
        << std::endl;
 }
 
+// Collects the glyph index pairs listed in the format 0 subtables of the sfnt
+// 'kern' table. Returns false when the face has no such subtable.
+static bool read_kern_table(FT_Face face, std::vector<std::pair<FT_UInt, FT_UInt>> &pairs) {
+    FT_ULong length = 0;
+    if (!FT_IS_SFNT(face) || FT_Load_Sfnt_Table(face, TTAG_kern, 0, nullptr, &length) != 0 || length < 4) {
+        return false;
+    }
+
+    std::vector<uint8_t> table(length);
+    if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, table.data(), &length) != 0) {
+        return false;
+    }
+
+    auto u16 = [&table](size_t offset) -> uint32_t {
+        return offset + 2 <= table.size() ? table[offset] << 8 | table[offset + 1] : 0;
+    };
+    auto u32 = [&u16](size_t offset) -> uint32_t {
+        return u16(offset) << 16 | u16(offset + 2);
+    };
+
+    // Microsoft tables start with a 16 bit version 0, Apple ones with 32 bit 1.0.
+    bool apple = u16(0) == 1;
+    size_t offset = apple ? 8 : 4;
+    uint32_t subtables = apple ? u32(4) : u16(2);
+    bool found = false;
+    for (uint32_t i = 0; i < subtables && offset < table.size(); i++) {
+        size_t header = apple ? 8 : 6;
+        uint32_t coverage = u16(offset + 4);
+        uint32_t format = apple ? coverage & 0xFF : coverage >> 8;
+        size_t next = offset + (apple ? u32(offset) : u16(offset + 2));
+        if (format == 0) {
+            uint32_t count = u16(offset + header);
+            size_t p = offset + header + 8;
+            for (uint32_t k = 0; k < count && p + 6 <= table.size(); k++, p += 6) {
+                pairs.emplace_back(u16(p), u16(p + 2));
+            }
+            // The 16 bit length of large Microsoft subtables overflows; trust nPairs.
+            next = p;
+            found = true;
+        }
+
+        if (next <= offset) {
+            break;
+        }
+        offset = next;
+    }
+    return found;
+}
+
+// Only the pairs the font lists are queried; faces without a format 0 'kern'
+// table (GPOS only fonts, class based subtables) fall back to querying every
+// pair of glyphs present in the ranges. Values always come from FT_Get_Kerning.
 void font_generator::read_kering(FT_Face face) {
-    FT_ULong from = 0xFFFF;
-    FT_ULong to = 0x0000;
+    if (!FT_HAS_KERNING(face)) {
+        return;
+    }
 
+    std::multimap<FT_UInt, FT_ULong> codes;
     for (auto &r : ranges) {
-        if (from > r.start) {
-            from = r.start;
+        for (FT_ULong code = r.start; code <= r.end; code++) {
+            FT_UInt index = FT_Get_Char_Index(face, code);
+            if (index != 0) {
+                codes.emplace(index, code);
+            }
         }
+    }
 
-        if (to < r.end) {
-            to = r.end;
+    auto add = [face, &codes, this](FT_UInt first, FT_UInt second) {
+        auto left = codes.equal_range(first);
+        auto right = codes.equal_range(second);
+        if (left.first == left.second || right.first == right.second) {
+            return true;
         }
-    }
 
-    std::map<std::string, std::vector<FT_UInt>> kern_map;
-    size_t count = 0;
-    for (auto i = from; i <= to; i++) {
-        if (!in_range(i)) {
-            continue;
+        FT_Vector v;
+        FT_Error error = FT_Get_Kerning(face, first, second, FT_KERNING_DEFAULT, &v);
+        if (error) {
+            return false;
+        }
+
+        int x = v.x / 64;
+        if (x == 0) {
+            return true;
         }
 
-        for (auto j = from; j <= to; j++) {
-            if (!in_range(j)) {
-                continue;
+        for (auto a = left.first; a != left.second; a++) {
+            for (auto b = right.first; b != right.second; b++) {
+                zoal::text::kerning_pair kd{(uint16_t) a->second, (uint16_t) b->second, (int8_t) x};
+                kerning.push_back(kd);
             }
+        }
+        return true;
+    };
 
-            FT_UInt a = FT_Get_Char_Index(face, i);
-            FT_UInt b = FT_Get_Char_Index(face, j);
-            FT_Vector v;
-            FT_Error error = FT_Get_Kerning(face, a, b, FT_KERNING_DEFAULT, &v);
-            if (error) {
+    std::vector<std::pair<FT_UInt, FT_UInt>> pairs;
+    if (read_kern_table(face, pairs)) {
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        for (auto &p : pairs) {
+            if (!add(p.first, p.second)) {
                 return;
             }
+        }
+    } else {
+        // Nothing is stored per candidate here: n^2 pairs of a CJK range would
+        // not fit in memory.
+        for (auto a = codes.begin(); a != codes.end(); a = codes.upper_bound(a->first)) {
+            for (auto b = codes.begin(); b != codes.end(); b = codes.upper_bound(b->first)) {
+                if (!add(a->first, b->first)) {
+                    return;
+                }
+            }
+        }
+    }
 
-            int x = v.x / 64;
-            if (x != 0) {
-                zoal::text::kerning_pair kd{(uint16_t) i, (uint16_t) j, (int8_t) x};
-                kerning.push_back(kd);
+    std::sort(kerning.begin(), kerning.end(), [](const zoal::text::kerning_pair &a, const zoal::text::kerning_pair &b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+}
+
+int font_generator::glyph_index(FT_ULong code) const {
+    for (auto &r : ranges) {
+        if (r.start <= code && code <= r.end) {
+            return code - r.start + r.base;
+        }
+    }
+    return -1;
+}
+
+// Groups glyphs with identical kerning rows into left classes and glyphs with
+// identical columns into right classes; both groupings are exact, so the class
+// matrix reproduces every pair. Class 0 is the "no kerning" class. Returns false
+// when a class id doesn't fit a byte or the tables are no smaller than the pairs.
+bool font_generator::make_kerning_classes() {
+    using row_type = std::vector<std::pair<int, int>>;
+    size_t count = glyphs_base + glyphs.size();
+    std::vector<row_type> rows(count);
+    std::vector<row_type> columns(count);
+    for (auto &kp : kerning) {
+        int a = glyph_index(kp.first);
+        int b = glyph_index(kp.second);
+        if (a < 0 || b < 0 || (size_t) a >= count || (size_t) b >= count) {
+            continue;
+        }
+
+        rows[a].emplace_back(b, kp.x_advance);
+        columns[b].emplace_back(a, kp.x_advance);
+    }
+
+    auto classify = [count](std::vector<row_type> &lines, std::vector<uint8_t> &classes) {
+        std::map<row_type, size_t> ids;
+        ids[row_type()] = 0;
+        classes.assign(count, 0);
+        for (size_t i = 0; i < count; i++) {
+            auto iter = ids.find(lines[i]);
+            if (iter == ids.end()) {
+                iter = ids.emplace(lines[i], ids.size()).first;
             }
+            classes[i] = iter->second > 0xFF ? 0 : iter->second;
+        }
+        return ids.size();
+    };
+
+    kern_left_count = classify(rows, kern_left);
+    kern_right_count = classify(columns, kern_right);
+    if (kern_left_count > 0xFF || kern_right_count > 0xFF) {
+        std::cout << "kerning: more than 255 classes" << std::endl;
+        return false;
+    }
+
+    kern_matrix.assign(kern_left_count * kern_right_count, 0);
+    for (size_t a = 0; a < count; a++) {
+        for (auto &p : rows[a]) {
+            kern_matrix[kern_left[a] * kern_right_count + kern_right[p.first]] = (int8_t) p.second;
         }
     }
+
+    // Two class bytes per glyph are paid whatever the kerning, so sparse
+    // kerning is smaller as 5 byte pairs.
+    size_t pair_bytes = kerning.size() * 5;
+    size_t class_bytes = count * 2 + kern_matrix.size();
+    std::cout << "kerning: " << kerning.size() << " pairs (" << pair_bytes << " bytes) -> "
+              << kern_left_count << "x" << kern_right_count << " classes (" << class_bytes << " bytes)" << std::endl;
+    return class_bytes < pair_bytes;
 }
 
-void font_generator::gen_kerning(std::fstream &fs, FT_Face face) {
+void font_generator::gen_kerning_classes(std::ostream &fs) {
+    std::string progmem = use_progmem ? " PROGMEM" : "";
+    auto table = [&fs, &progmem, this](const char *type, const char *suffix, const std::vector<int> &values) {
+        fs << "static const " << type << " " << font_name << suffix << "[]" << progmem << " = {";
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i % 16 == 0) {
+                fs << std::endl;
+            }
+            fs << std::dec << values[i] << ", ";
+        }
+        fs << "0 };" << std::endl
+           << std::endl;
+    };
+
+    table("uint8_t", "_kern_left", std::vector<int>(kern_left.begin(), kern_left.end()));
+    table("uint8_t", "_kern_right", std::vector<int>(kern_right.begin(), kern_right.end()));
+    table("int8_t", "_kern_matrix", std::vector<int>(kern_matrix.begin(), kern_matrix.end()));
+
+    fs << "const zoal::text::kerning_classes " << font_name << "_kerning_classes{";
+    fs << font_name << "_kern_left, " << font_name << "_kern_right, " << font_name << "_kern_matrix, ";
+    fs << std::dec << kern_left_count << ", " << kern_right_count << "};" << std::endl
+       << std::endl;
+}
+
+void font_generator::gen_kerning(std::ostream &fs, FT_Face face) {
     std::string progmem = use_progmem ? " PROGMEM" : "";
     fs << "static const zoal::text::kerning_pair " << font_name << "_kerning[] " << progmem << " = {" << std::endl;
 
@@ -305,19 +1069,40 @@ void font_generator::gen_kerning(std::fstream &fs, FT_Face face) {
        << "};" << std::endl;
 }
 
-void font_generator::generate_font(std::fstream &fs) const {
+void font_generator::generate_font(std::ostream &fs) const {
+    if (use_lz) {
+        fs << "const zoal::text::packed_font " << font_name << "{";
+        fs << std::dec << (int) font_size << ", " << (int) bpp << ", ";
+        fs << font_name << "_lz, " << lz_buffer.size() << ", " << buffer.size() << ", " << glyphs.size() << ", ";
+        fs << font_name << "_ranges, " << ranges.size();
+        if (use_kern && !use_kern_classes) {
+            fs << ", " << font_name << "_kerning, " << std::dec << kerning.size();
+        } else {
+            fs << ", nullptr, 0";
+        }
+        fs << "};" << std::endl;
+        return;
+    }
+
     fs << "const zoal::text::font " << font_name << "{";
     fs << std::dec << (int) font_size << ", ";
     fs << font_name << "_bitmap, ";
     fs << font_name << "_glyphs, ";
-    fs << std::dec << glyphs.size() << ", ";
+    fs << std::dec << glyphs_base + glyphs.size() << ", ";
     fs << font_name << "_ranges,";
     fs << std::dec << ranges.size();
-    if (use_kern) {
+    if (use_kern && !use_kern_classes) {
         fs << ", " << font_name << "_kerning, " << std::dec << kerning.size();
     } else {
         fs << ", nullptr, 0";
     }
-
-    fs << "};" << std::endl;
+    if (bpp > 1) {
+        fs << ", " << std::dec << (int) bpp << "};" << std::endl;
+    } else {
+        fs << std::endl
+           << "#ifdef ZOAL_TEXT_FONT_BITS_PER_PIXEL" << std::endl
+           << ", 1" << std::endl
+           << "#endif" << std::endl
+           << "};" << std::endl;
+    }
 }
@@ -1,6 +1,7 @@
 #ifndef ZOAL_FONT_GENERATOR_FONT_GENERATOR_H
 #define ZOAL_FONT_GENERATOR_FONT_GENERATOR_H
 
+#include "rasterizer.h"
 #include "types.hpp"
 
 #include <ft2build.h>
@@ -18,25 +19,72 @@ public:
     std::vector<zoal::text::glyph> glyphs;
     std::vector<uint8_t> buffer;
     std::vector<zoal::text::kerning_pair> kerning;
+    std::vector<uint8_t> kern_left;
+    std::vector<uint8_t> kern_right;
+    std::vector<int8_t> kern_matrix;
+    size_t kern_left_count{0};
+    size_t kern_right_count{0};
     std::string font_name{"roboto_regular_24"};
     std::vector<zoal::text::unicode_range> ranges;
     bool use_progmem{false};
     bool use_kern{false};
+    bool use_kern_classes{false};
+    bool use_stream{false};
+    bool use_split{false};
+    uint16_t flash_page{0};
+    uint16_t rotation{0};
+    uint8_t bpp{1};
+    bool use_dither{false};
+    bool use_digits{false};
+    bool use_lz{false};
+    std::vector<uint8_t> lz_buffer;
+    long lz_decode_us{0};
+    std::vector<uint8_t> digits_buffer;
+    zoal::text::digit_strip digits{};
+    size_t stream_window{64 * 1024};
+    uint32_t bitmap_base{0};
+    uint16_t glyphs_base{0};
+    std::fstream stream_src;
+    std::fstream stream_glyphs;
+
+    rasterizer *raster{nullptr};
 
     zoal::text::font current_font;
 
-    int rasterize_font();
+    int rasterize_font(FT_Face face);
     int generate_fonts_file();
 
     void read_kering(FT_Face face);
-    void create_bitmap_glyph(FT_GlyphSlot slot);
-    void make_range(FT_Face face, FT_ULong range_from, FT_ULong range_to);
+    bool make_kerning_classes();
+    void gen_kerning_classes(std::ostream &fs);
+    int glyph_index(FT_ULong code) const;
+    void create_bitmap_glyph(const rendered_glyph &rg);
+    void pack_glyph(zoal::text::glyph &g, const rendered_glyph &rg);
+    void make_range(FT_ULong range_from, FT_ULong range_to);
+    void make_digits();
+    void generate_digits(std::ostream &fs);
     void generate_src(FT_Face face);
-    void generate_bitmap(std::fstream &fs);
-    void generate_glyphs(std::fstream &fs);
-    void generate_ranges(std::fstream &fs);
-    void gen_kerning(std::fstream &fs, FT_Face face);
-    void generate_font(std::fstream &fs) const;
+    void write_src(std::ostream &fs, FT_Face face);
+    void generate_header();
+    void write_header(std::ostream &fs) const;
+    void write_type_extensions(std::ostream &fs) const;
+    void generate_split_src(FT_Face face);
+    std::string part_name(const zoal::text::unicode_range &r) const;
+    bool generate_flash_image();
+    bool write_flash_image(std::ostream &fs);
+    void begin_stream();
+    void flush_stream();
+    void end_stream(FT_Face face);
+    void pack_lz();
+    void generate_lz(std::ostream &fs);
+    void generate_bitmap(std::ostream &fs);
+    void write_bitmap_bytes(std::ostream &fs);
+    void generate_glyphs(std::ostream &fs);
+    void write_glyph(std::ostream &fs, const zoal::text::glyph &g);
+    void generate_ranges(std::ostream &fs);
+    void gen_kerning(std::ostream &fs, FT_Face face);
+    void generate_font(std::ostream &fs) const;
+    std::string output_path(const char *ext) const;
     bool in_range(FT_ULong value);
 };
 
@@ -0,0 +1,29 @@
+#ifndef ZOAL_FONT_GENERATOR_FONT_PARTS_HPP
+#define ZOAL_FONT_GENERATOR_FONT_PARTS_HPP
+
+#include "types.hpp"
+
+namespace zoal {
+    namespace text {
+        // Returns the part of a split font (GenFont --split) that covers the code point.
+        // parts is the firmware's own list of the parts it uses; only those are
+        // referenced, so --gc-sections drops the others. nullptr entries are skipped.
+        inline const font *find_part(const font *const *parts, uint16_t count, uint16_t code) {
+            for (uint16_t i = 0; i < count; i++) {
+                const font *f = parts[i];
+                if (f == nullptr) {
+                    continue;
+                }
+
+                for (uint16_t k = 0; k < f->ranges_count; k++) {
+                    if (f->ranges[k].start <= code && code <= f->ranges[k].end) {
+                        return f;
+                    }
+                }
+            }
+            return nullptr;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,405 @@
+#include "font_generator.h"
+#include "glyph_render.hpp"
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+// 128x64 canvas in SH1106 page layout: byte x + 128 * page holds 8 vertical
+// pixels, bit 0 being the topmost one.
+class page_canvas {
+public:
+    using pixel_type = uint8_t;
+
+    static constexpr int width = 128;
+    static constexpr int height = 64;
+
+    void pixel(int x, int y, pixel_type c) {
+        if (x < 0 || x >= width || y < 0 || y >= height) {
+            clipped++;
+            return;
+        }
+
+        uint8_t mask = 1 << (y & 7);
+        if (c) {
+            buffer[x + (y >> 3) * width] |= mask;
+        } else {
+            buffer[x + (y >> 3) * width] &= ~mask;
+        }
+    }
+
+    void clear() {
+        memset(buffer, 0, sizeof(buffer));
+    }
+
+    uint32_t hash() const {
+        uint32_t h = 2166136261u;
+        for (auto b : buffer) {
+            h = (h ^ b) * 16777619u;
+        }
+        return h;
+    }
+
+    uint8_t buffer[width * height / 8];
+    uint32_t clipped{0};
+};
+
+static const char *font_files[] = {"FreeSans.ttf", "OpenSans-Regular.ttf", "Pixel-UniCode.ttf", "Roboto-Regular.ttf"};
+static const int font_sizes[] = {12, 16, 24};
+static const char *font_ranges[] = {"20-7e", "370-3ff", "400-4ff"};
+static const wchar_t *samples[] = {
+        L"Sphinx of black quartz 0123",
+        L"Съешь же ещё этих булок",
+        L"Ξεσκεπάζω την ψυχοφθόρα",
+        L"{[(@#$%&*)]} ~!?;:"};
+
+struct result {
+    std::string key;
+    size_t bitmap_size;
+    uint32_t source_hash;
+    uint32_t render_cost;
+    uint32_t clipped;
+    std::vector<uint32_t> hashes;
+};
+
+static uint32_t fnv1a(const std::string &text) {
+    uint32_t h = 2166136261u;
+    for (auto c : text) {
+        h = (h ^ (uint8_t) c) * 16777619u;
+    }
+    return h;
+}
+
+static const zoal::text::glyph *find_glyph(const zoal::text::font *font, wchar_t ch) {
+    auto code = (uint16_t) ch;
+    for (int i = 0; i < font->ranges_count; i++) {
+        const zoal::text::unicode_range *r = font->ranges + i;
+        if (r->start <= code && code <= r->end) {
+            return font->glyphs + (code - r->start + r->base);
+        }
+    }
+    return nullptr;
+}
+
+// Pen advance and ink box of a word relative to the pen and the baseline.
+struct extent {
+    int advance{0};
+    int left{0};
+    int right{0};
+    int top{0};
+    int bottom{0};
+};
+
+static extent measure(const zoal::text::font *font, const std::wstring &word) {
+    extent e;
+    for (auto ch : word) {
+        auto g = find_glyph(font, ch);
+        if (g == nullptr) {
+            continue;
+        }
+
+        if (g->width > 0 && g->height > 0) {
+            e.left = std::min(e.left, e.advance + g->x_offset);
+            e.right = std::max(e.right, e.advance + g->x_offset + g->width);
+            e.top = std::min(e.top, (int) g->y_offset);
+            e.bottom = std::max(e.bottom, g->y_offset + g->height);
+        }
+        e.advance += g->x_advance;
+    }
+    return e;
+}
+
+// Splits text at spaces, and words wider than the canvas at the last character
+// that still fits.
+static std::vector<std::wstring> split_words(const zoal::text::font *font, const wchar_t *text) {
+    std::vector<std::wstring> words;
+    std::wistringstream is(text);
+    std::wstring word;
+    while (is >> word) {
+        while (!word.empty()) {
+            size_t n = word.size();
+            for (; n > 1; n--) {
+                auto e = measure(font, word.substr(0, n));
+                if (e.right - std::min(e.left, 0) <= page_canvas::width) {
+                    break;
+                }
+            }
+            words.push_back(word.substr(0, n));
+            word.erase(0, n);
+        }
+    }
+    return words;
+}
+
+struct placed_word {
+    int x;
+    int y;
+    std::wstring text;
+};
+
+using screen = std::vector<placed_word>;
+
+// Word-wraps every sample onto as many 128x64 screens as it needs. Anything that
+// still doesn't fit shows up as clipped pixels when the screens are rendered.
+static std::vector<screen> layout_samples(const zoal::text::font *font) {
+    std::vector<screen> screens;
+    auto space = find_glyph(font, L' ');
+    const int space_advance = space != nullptr ? space->x_advance : font->y_advance / 3;
+    for (auto text : samples) {
+        int x = 0;
+        int baseline = font->y_advance;
+        screens.emplace_back();
+        for (auto &word : split_words(font, text)) {
+            auto e = measure(font, word);
+            int pen = x == 0 ? 0 : x + space_advance;
+            if (pen != 0 && pen + e.right > page_canvas::width) {
+                pen = 0;
+                baseline += font->y_advance;
+                if (baseline + e.bottom > page_canvas::height) {
+                    screens.emplace_back();
+                    baseline = font->y_advance;
+                }
+            }
+
+            pen = std::max(pen, -e.left);
+            screens.back().push_back({pen, baseline, word});
+            x = pen + e.advance;
+        }
+    }
+    return screens;
+}
+
+static void render_screens(page_canvas &canvas, const zoal::text::font *font, const std::vector<screen> &screens, std::vector<uint32_t> *hashes) {
+    zoal::gfx::glyph_render<page_canvas> gl(&canvas, font);
+    for (auto &s : screens) {
+        canvas.clear();
+        for (auto &w : s) {
+            gl.position(w.x, w.y);
+            gl.draw(w.text.c_str(), 1);
+        }
+
+        if (hashes != nullptr) {
+            hashes->push_back(canvas.hash());
+        }
+    }
+}
+
+// Pixel writes over the whole canvas: a reference workload timed next to every
+// render batch, so render costs are relative to this host's speed at the time.
+static void calibrate(page_canvas &canvas) {
+    for (int y = 0; y < page_canvas::height; y++) {
+        for (int x = 0; x < page_canvas::width; x++) {
+            canvas.pixel(x, y, (x ^ y) & 1);
+        }
+    }
+}
+
+template<class Work>
+static uint64_t time_ns(int rounds, Work work) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        work();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / rounds;
+}
+
+static std::string case_key(const char *file, int size) {
+    return std::string(file) + "@" + std::to_string(size);
+}
+
+static result run_case(rasterizer &raster, const std::string &dir, const char *file, int size, int rounds, uint32_t cost_limit) {
+    font_generator gen;
+    gen.raster = &raster;
+    gen.font_path = dir + "/" + file;
+    gen.font_size = size;
+    gen.font_name = "regress_font";
+    gen.use_kern = true;
+    gen.font_ranges.assign(std::begin(font_ranges), std::end(font_ranges));
+
+    FT_Face face = raster.face(gen.font_path, gen.font_size);
+    if (gen.rasterize_font(face) != 0) {
+        throw std::runtime_error("can't open font " + gen.font_path);
+    }
+
+    result r;
+    r.key = case_key(file, size);
+    r.bitmap_size = gen.buffer.size();
+
+    std::ostringstream source;
+    gen.write_header(source);
+    gen.write_src(source, face);
+    r.source_hash = fnv1a(source.str());
+
+    page_canvas canvas;
+    auto screens = layout_samples(&gen.current_font);
+    render_screens(canvas, &gen.current_font, screens, &r.hashes);
+    r.clipped = canvas.clipped;
+
+    // Best of 25 batches of each, interleaved so both see the same clock speed.
+    auto measure = [&canvas, &gen, &screens, rounds]() {
+        uint64_t render_ns = UINT64_MAX;
+        uint64_t reference_ns = UINT64_MAX;
+        for (int batch = 0; batch < 25; batch++) {
+            reference_ns = std::min(reference_ns, time_ns(rounds, [&canvas]() { calibrate(canvas); }));
+            render_ns = std::min(render_ns, time_ns(rounds, [&canvas, &gen, &screens]() { render_screens(canvas, &gen.current_font, screens, nullptr); }));
+        }
+        return (uint32_t) (render_ns * 1000 / std::max<uint64_t>(reference_ns, 1));
+    };
+
+    // A cost over the limit is measured again before it counts, so a burst of
+    // load on the host doesn't fail the gate.
+    r.render_cost = measure();
+    for (int retry = 0; retry < 3 && r.render_cost > cost_limit; retry++) {
+        r.render_cost = std::min(r.render_cost, measure());
+    }
+    return r;
+}
+
+// One line per case: key, bitmap size, hash of the emitted header and source,
+// render cost in thousandths of the calibration workload, screen hashes.
+static std::map<std::string, result> read_goldens(const std::string &path) {
+    std::map<std::string, result> goldens;
+    std::ifstream fs(path);
+    std::string line;
+    while (std::getline(fs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream is(line);
+        result r;
+        is >> r.key >> r.bitmap_size >> std::hex >> r.source_hash >> std::dec >> r.render_cost;
+        uint32_t h;
+        while (is >> std::hex >> h) {
+            r.hashes.push_back(h);
+        }
+        goldens[r.key] = r;
+    }
+    return goldens;
+}
+
+static void write_goldens(const std::string &path, const std::vector<result> &results) {
+    std::ofstream fs(path);
+    fs << "# FontRegress goldens: font@size bitmap_bytes source_hash render_cost screen_hashes..." << std::endl;
+    for (auto &r : results) {
+        fs << r.key << " " << std::dec << r.bitmap_size << " " << std::hex << std::setfill('0') << std::setw(8) << r.source_hash
+           << " " << std::dec << r.render_cost;
+        for (auto h : r.hashes) {
+            fs << " " << std::hex << std::setfill('0') << std::setw(8) << h;
+        }
+        fs << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        namespace po = boost::program_options;
+        po::options_description desc("Options");
+
+        desc.add_options()
+                ("help,h", "display help")
+                ("fonts", po::value<std::string>()->default_value("../fonts"), "directory with the bundled fonts")
+                ("goldens", po::value<std::string>()->default_value("../font_regress.golden"), "goldens file")
+                ("update", "rewrite the goldens file from the current output")
+                ("threshold", po::value<double>()->default_value(5.0), "allowed bitmap size growth, percent")
+                ("perf-gate", "fail on render cost regressions, not only report them")
+                ("time-threshold", po::value<double>()->default_value(30.0), "allowed render cost growth with --perf-gate, percent")
+                ("rounds", po::value<int>()->default_value(50), "render rounds per timing batch");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+
+        auto dir = vm["fonts"].as<std::string>();
+        auto path = vm["goldens"].as<std::string>();
+        auto size_limit = 1.0 + vm["threshold"].as<double>() / 100.0;
+        auto time_limit = 1.0 + vm["time-threshold"].as<double>() / 100.0;
+        auto rounds = vm["rounds"].as<int>();
+        auto perf_gate = vm.count("perf-gate") != 0;
+
+        auto update = vm.count("update") != 0;
+        auto goldens = update ? std::map<std::string, result>() : read_goldens(path);
+
+        rasterizer raster;
+        std::vector<result> results;
+        for (auto file : font_files) {
+            for (auto size : font_sizes) {
+                auto it = goldens.find(case_key(file, size));
+                uint32_t cost_limit = perf_gate && it != goldens.end() ? (uint32_t) (it->second.render_cost * time_limit) : UINT32_MAX;
+                results.push_back(run_case(raster, dir, file, size, rounds, cost_limit));
+            }
+        }
+
+        if (update) {
+            for (auto &r : results) {
+                if (r.clipped != 0) {
+                    throw std::runtime_error(r.key + ": samples don't fit the canvas, not writing goldens");
+                }
+            }
+            write_goldens(path, results);
+            std::cout << results.size() << " cases written to " << path << std::endl;
+            return 0;
+        }
+
+        int failures = 0;
+        for (auto &r : results) {
+            std::ostringstream problems;
+            std::ostringstream notes;
+            if (r.clipped != 0) {
+                problems << " " << r.clipped << " pixels clipped;";
+            }
+
+            auto it = goldens.find(r.key);
+            if (it == goldens.end()) {
+                problems << " no golden;";
+            } else {
+                auto &g = it->second;
+                if (r.hashes != g.hashes) {
+                    problems << " pixels differ;";
+                }
+                if (r.source_hash != g.source_hash) {
+                    problems << " emitted source differs;";
+                }
+                if (r.bitmap_size > g.bitmap_size * size_limit) {
+                    problems << " bitmap " << g.bitmap_size << " -> " << r.bitmap_size << " bytes;";
+                }
+                if (r.render_cost > g.render_cost * time_limit) {
+                    if (perf_gate) {
+                        problems << " render cost " << g.render_cost << " -> " << r.render_cost << ";";
+                    } else {
+                        notes << " [render cost " << g.render_cost << " -> " << r.render_cost << ", not gated]";
+                    }
+                }
+            }
+
+            auto text = problems.str();
+            std::cout << std::left << std::setw(28) << r.key << (text.empty() ? " ok" : " FAIL" + text) << notes.str() << std::endl;
+            failures += text.empty() ? 0 : 1;
+        }
+
+        std::cout << results.size() - failures << " of " << results.size() << " cases passed" << std::endl;
+        return failures == 0 ? 0 : 1;
+    } catch (std::exception &exc) {
+        std::cerr << exc.what() << std::endl;
+        return 1;
+    }
+}
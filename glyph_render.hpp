@@ -0,0 +1,132 @@
+#ifndef ZOAL_FONT_GENERATOR_GLYPH_RENDER_HPP
+#define ZOAL_FONT_GENERATOR_GLYPH_RENDER_HPP
+
+#include "types.hpp"
+
+#include <stdint.h>
+
+namespace zoal {
+    namespace gfx {
+        // Clockwise rotation the font was generated with (GenFont --rotate). Glyphs
+        // are already in panel coordinates, so only the pen direction changes.
+        enum class orientation { deg_0, deg_90, deg_180, deg_270 };
+
+        template<class Graphics, orientation Orientation = orientation::deg_0>
+        class glyph_render {
+        public:
+            using self_type = glyph_render<Graphics, Orientation>;
+            using pixel_type = typename Graphics::pixel_type;
+
+            glyph_render(Graphics *g, const zoal::text::font *font) : graphics_(g), font_(font) {
+            }
+
+            void draw(const wchar_t ch, pixel_type fg) {
+                const zoal::text::unicode_range *range = nullptr;
+                auto code = (uint16_t) ch;
+                for (int i = 0; i < font_->ranges_count; i++) {
+                    const zoal::text::unicode_range *r = font_->ranges + i;
+                    if (r->start <= code && code <= r->end) {
+                        range = r;
+                        break;
+                    }
+                }
+
+                if (range == nullptr) {
+                    return;
+                }
+
+                auto pos = code - range->start + range->base;
+                auto glyph = font_->glyphs + pos;
+                render_glyph(glyph, fg);
+            }
+
+            void draw(const wchar_t *text, pixel_type fg) {
+                while (*text) {
+                    draw(*text++, fg);
+                }
+            }
+
+            self_type &position(int x, int y) {
+                x_ = x;
+                y_ = y;
+                return *this;
+            }
+
+            self_type &background(pixel_type bg) {
+                bg_ = bg;
+                return *this;
+            }
+
+        private:
+            void render_glyph(const zoal::text::glyph *g, pixel_type fg) {
+                if (font_->bits_per_pixel > 1) {
+                    render_levels(g, fg);
+                } else {
+                    render_mono(g, fg);
+                }
+                advance(g);
+            }
+
+            void render_mono(const zoal::text::glyph *g, pixel_type fg) {
+                const uint8_t *data = font_->bitmap + g->bitmap_offset;
+                const uint8_t bytes_per_row = (g->width + 7) >> 3;
+                for (int y = 0; y < g->height; y++) {
+                    auto row = data + y * bytes_per_row;
+                    for (int x = 0; x < g->width; x++) {
+                        auto ptr = row + (x >> 3);
+                        int mask = 0x80 >> (x & 7);
+                        int value = *ptr & mask;
+                        graphics_->pixel(x_ + x + g->x_offset, y_ + y + g->y_offset, value ? fg : bg_);
+                    }
+                }
+            }
+
+            // 2bpp/4bpp glyphs: every level is blended between background and
+            // foreground once per glyph, pixels are then a table lookup.
+            void render_levels(const zoal::text::glyph *g, pixel_type fg) {
+                const int bpp = font_->bits_per_pixel;
+                const int max_level = (1 << bpp) - 1;
+                pixel_type blend[16];
+                for (int l = 0; l <= max_level; l++) {
+                    blend[l] = (pixel_type) (bg_ + ((int) fg - (int) bg_) * l / max_level);
+                }
+
+                const uint8_t *data = font_->bitmap + g->bitmap_offset;
+                const int bytes_per_row = (g->width * bpp + 7) >> 3;
+                for (int y = 0; y < g->height; y++) {
+                    auto row = data + y * bytes_per_row;
+                    for (int x = 0; x < g->width; x++) {
+                        int bit = x * bpp;
+                        int level = (row[bit >> 3] >> (8 - bpp - (bit & 7))) & max_level;
+                        graphics_->pixel(x_ + x + g->x_offset, y_ + y + g->y_offset, blend[level]);
+                    }
+                }
+            }
+
+            void advance(const zoal::text::glyph *g) {
+                switch (Orientation) {
+                    case orientation::deg_0:
+                        x_ += g->x_advance;
+                        break;
+                    case orientation::deg_90:
+                        y_ += g->x_advance;
+                        break;
+                    case orientation::deg_180:
+                        x_ -= g->x_advance;
+                        break;
+                    case orientation::deg_270:
+                        y_ -= g->x_advance;
+                        break;
+                }
+            }
+
+            Graphics *graphics_;
+            const zoal::text::font *font_{nullptr};
+            pixel_type bg_{0};
+            int x_{0};
+            int y_{0};
+        };
+    }
+}
+
+#endif
@@ -3,7 +3,10 @@
 #include <QApplication>
 
 #include "font_generator.h"
+#include "instrumented_reader.hpp"
+#include "simulator.h"
 #include <boost/program_options.hpp>
+#include <cwchar>
 #include <iostream>
 
 #include <zoal/gfx/glyph_renderer.hpp>
@@ -11,6 +14,7 @@
 #include <zoal/ic/sh1106.hpp>
 #include <zoal/io/output_stream.hpp>
 
+rasterizer raster;
 font_generator generator;
 extern uint8_t canvas[1024];
 
@@ -25,11 +29,80 @@ public:
     }
 };
 
+static void profile_string(const zoal::text::font *font, const char *label, const wchar_t *text) {
+    using profiled_renderer = zoal::gfx::glyph_renderer<graphics, zoal::text::instrumented_reader>;
+    static uint8_t scratch[1024];
+    auto g = graphics::from_memory(scratch);
+    profiled_renderer gl(g, font);
+    auto &profile = zoal::text::instrumented_reader::profile();
+
+    profile.reset();
+    gl.color(1);
+    gl.position(0, font->y_advance);
+    gl.draw(text);
+
+    std::cout << label << std::endl;
+    profile.print(std::cout, zoal::text::avr_lpm);
+    std::cout << "    ~" << profile.cycles(zoal::text::cortex_m0_flash) << " cycles (" << zoal::text::cortex_m0_flash.name << ")" << std::endl;
+}
+
+class menu_screen {
+public:
+    uint32_t operator()(uint8_t *canvas, input_event event) {
+        switch (event) {
+            case input_event::rotate_ccw:
+                step(-1);
+                break;
+            case input_event::rotate_cw:
+                step(1);
+                break;
+            case input_event::press:
+                editing = !editing;
+                break;
+            default:
+                if (!dirty) {
+                    return 0;
+                }
+                break;
+        }
+
+        dirty = false;
+        counting_graphics<graphics> g(graphics::from_memory(canvas));
+        zoal::gfx::glyph_renderer<counting_graphics<graphics>, mem_reader> gl(&g, &generator.current_font);
+        auto line = generator.current_font.y_advance;
+        g.clear(0);
+        gl.color(1);
+        for (int i = 0; i < items_count; i++) {
+            wchar_t text[32];
+            swprintf(text, 32, L"%ls%ls %d", i == selected ? (editing ? L"* " : L"> ") : L"  ", items[i], values[i]);
+            gl.position(0, line * (i + 1));
+            gl.draw(text);
+        }
+        return g.writes();
+    }
+
+private:
+    void step(int delta) {
+        if (editing) {
+            values[selected] += delta;
+        } else {
+            selected = (selected + items_count + delta) % items_count;
+        }
+    }
+
+    static constexpr int items_count = 3;
+    const wchar_t *items[items_count]{L"Volume", L"Brightness", L"Contrast"};
+    int values[items_count]{50, 80, 30};
+    int selected{0};
+    bool editing{false};
+    bool dirty{true};
+};
+
 int main(int argc, char *argv[]) {
     namespace po = boost::program_options;
     po::options_description desc("Options");
 
-    desc.add_options()("help,h", "display help")("font,f", po::value<std::string>(), "path to font")("size,s", po::value<int>(), "font size")("progmem", "use PROGMEM")("kern", "use kerning")("ranges,r", po::value<std::vector<std::string>>(), "unicode char ranges: 0x0020-0x007")("name,n", po::value<std::string>(), "output font name");
+    desc.add_options()("help,h", "display help")("font,f", po::value<std::string>(), "path to font")("size,s", po::value<int>(), "font size")("progmem", "use PROGMEM")("kern", "use kerning")("ranges,r", po::value<std::vector<std::string>>(), "unicode char ranges: 0x0020-0x007")("name,n", po::value<std::string>(), "output font name")("profile", "print estimated flash read cost of sample strings");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -73,6 +146,7 @@ int main(int argc, char *argv[]) {
 //        return -1;
 //    }
 
+    generator.raster = &raster;
     generator.generate_fonts_file();
 
     auto g = graphics::from_memory(canvas);
@@ -95,8 +169,20 @@ int main(int argc, char *argv[]) {
     gl.position(10, generator.current_font.y_advance * 2);
     gl.draw(L"ІіЇї₴ЄєґҐ");
 
+    if (vm.count("profile")) {
+        auto &profile = zoal::text::instrumented_reader::profile();
+        profile.attach(&generator.current_font);
+        profile_string(&generator.current_font, "latin", L"Hello World");
+        profile_string(&generator.current_font, "cyrillic", L"ІіЇї₴ЄєґҐ");
+        profile.print_font(std::cout, zoal::text::avr_lpm);
+    }
+
+    simulator sim{menu_screen()};
+    sim.start(std::chrono::milliseconds(16));
+
     QApplication app(argc, argv);
     MainWindow wnd;
+    wnd.attach(&sim);
     wnd.show();
     return app.exec();
 }
@@ -0,0 +1,236 @@
+#ifndef ZOAL_FONT_GENERATOR_INSTRUMENTED_READER_HPP
+#define ZOAL_FONT_GENERATOR_INSTRUMENTED_READER_HPP
+
+#include "types.hpp"
+
+#include <iomanip>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zoal {
+    namespace text {
+        enum class font_table { bitmap = 0, glyphs, ranges, kerning, other, count };
+
+        // Per-access costs of the memory the font tables live in, and the size of
+        // a glyph, unicode_range and kerning_pair entry in the target's layout:
+        // AVR packs them, ARM pads them to their alignment.
+        struct read_cost_model {
+            const char *name;
+            uint32_t cycles_per_read;
+            uint32_t cycles_per_byte;
+            uint8_t glyph_size;
+            uint8_t range_size;
+            uint8_t kerning_pair_size;
+        };
+
+        constexpr read_cost_model avr_lpm{"avr-lpm", 4, 3, 9, 6, 5};
+        constexpr read_cost_model avr_sram{"avr-sram", 2, 2, 9, 6, 5};
+        constexpr read_cost_model cortex_m0_flash{"cortex-m0-flash", 2, 1, 12, 6, 6};
+
+        // Table entries are counted by kind and sized by the cost model; other
+        // reads are counted in bytes.
+        enum class entry_kind { none = 0, glyph, range, kerning_pair, count };
+
+        template<class T>
+        struct entry_of {
+            static constexpr entry_kind value = entry_kind::none;
+        };
+
+        template<>
+        struct entry_of<glyph> {
+            static constexpr entry_kind value = entry_kind::glyph;
+        };
+
+        template<>
+        struct entry_of<unicode_range> {
+            static constexpr entry_kind value = entry_kind::range;
+        };
+
+        template<>
+        struct entry_of<kerning_pair> {
+            static constexpr entry_kind value = entry_kind::kerning_pair;
+        };
+
+        struct table_stats {
+            uint32_t reads;
+            uint32_t bytes;
+            uint32_t entries[static_cast<int>(entry_kind::count)];
+
+            // Bytes fetched on the target described by model.
+            uint64_t device_bytes(const read_cost_model &model) const {
+                return (uint64_t) bytes + (uint64_t) entries[static_cast<int>(entry_kind::glyph)] * model.glyph_size +
+                       (uint64_t) entries[static_cast<int>(entry_kind::range)] * model.range_size +
+                       (uint64_t) entries[static_cast<int>(entry_kind::kerning_pair)] * model.kerning_pair_size;
+            }
+        };
+
+        class read_profile {
+        public:
+            static const char *table_name(font_table t) {
+                static const char *names[] = {"bitmap", "glyphs", "ranges", "kerning", "other"};
+                return names[static_cast<int>(t)];
+            }
+
+            void attach(const font *f) {
+                font_ = f;
+                bitmap_size_ = 0;
+                for (uint16_t i = 0; f != nullptr && i < f->glyphs_count; i++) {
+                    auto &g = f->glyphs[i];
+                    uint32_t bpp = f->bits_per_pixel > 1 ? f->bits_per_pixel : 1;
+                    uint32_t end = g.bitmap_offset + ((g.width * bpp + 7) >> 3) * g.height;
+                    bitmap_size_ = end > bitmap_size_ ? end : bitmap_size_;
+                }
+                clear(font_stats_);
+                reset();
+            }
+
+            // Starts a new string; the per-font totals keep accumulating until
+            // the next attach().
+            void reset() {
+                clear(stats_);
+            }
+
+            void record(const void *ptr, entry_kind kind, size_t bytes) {
+                auto table = static_cast<int>(classify(ptr));
+                add(stats_[table], kind, bytes);
+                add(font_stats_[table], kind, bytes);
+            }
+
+            const table_stats &stats(font_table t) const {
+                return stats_[static_cast<int>(t)];
+            }
+
+            const table_stats &font_stats(font_table t) const {
+                return font_stats_[static_cast<int>(t)];
+            }
+
+            table_stats total() const {
+                return sum(stats_);
+            }
+
+            table_stats font_total() const {
+                return sum(font_stats_);
+            }
+
+            uint64_t cycles(const read_cost_model &model) const {
+                return cost(total(), model);
+            }
+
+            uint64_t font_cycles(const read_cost_model &model) const {
+                return cost(font_total(), model);
+            }
+
+            void print_font(std::ostream &os, const read_cost_model &model) const {
+                auto t = font_total();
+                os << std::setw(8) << "font" << ": " << t.reads << " reads, " << t.device_bytes(model) << " bytes, ~"
+                   << font_cycles(model) << " cycles (" << model.name << ")" << std::endl;
+            }
+
+            void print(std::ostream &os, const read_cost_model &model) const {
+                for (int i = 0; i < static_cast<int>(font_table::count); i++) {
+                    auto t = static_cast<font_table>(i);
+                    auto &s = stats(t);
+                    if (s.reads == 0) {
+                        continue;
+                    }
+
+                    os << std::setw(8) << table_name(t) << ": " << s.reads << " reads, " << s.device_bytes(model) << " bytes" << std::endl;
+                }
+
+                auto t = total();
+                os << std::setw(8) << "total" << ": " << t.reads << " reads, " << t.device_bytes(model) << " bytes, ~"
+                   << cycles(model) << " cycles (" << model.name << ")" << std::endl;
+            }
+
+        private:
+            using table_set = table_stats[static_cast<int>(font_table::count)];
+
+            static void clear(table_set &set) {
+                for (auto &s : set) {
+                    s = table_stats{};
+                }
+            }
+
+            static void add(table_stats &s, entry_kind kind, size_t bytes) {
+                s.reads++;
+                if (kind == entry_kind::none) {
+                    s.bytes += bytes;
+                } else {
+                    s.entries[static_cast<int>(kind)]++;
+                }
+            }
+
+            static table_stats sum(const table_set &set) {
+                table_stats result{};
+                for (auto &s : set) {
+                    result.reads += s.reads;
+                    result.bytes += s.bytes;
+                    for (int i = 0; i < static_cast<int>(entry_kind::count); i++) {
+                        result.entries[i] += s.entries[i];
+                    }
+                }
+                return result;
+            }
+
+            static uint64_t cost(const table_stats &t, const read_cost_model &model) {
+                return (uint64_t) t.reads * model.cycles_per_read + t.device_bytes(model) * model.cycles_per_byte;
+            }
+
+            static bool inside(const void *ptr, const void *begin, size_t size) {
+                auto p = static_cast<const uint8_t *>(ptr);
+                auto b = static_cast<const uint8_t *>(begin);
+                return b != nullptr && p >= b && p < b + size;
+            }
+
+            font_table classify(const void *ptr) const {
+                if (font_ == nullptr) {
+                    return font_table::other;
+                }
+
+                if (inside(ptr, font_->bitmap, bitmap_size_)) {
+                    return font_table::bitmap;
+                }
+
+                if (inside(ptr, font_->glyphs, font_->glyphs_count * sizeof(glyph))) {
+                    return font_table::glyphs;
+                }
+
+                if (inside(ptr, font_->ranges, font_->ranges_count * sizeof(unicode_range))) {
+                    return font_table::ranges;
+                }
+
+                if (inside(ptr, font_->kerning_pairs, font_->kerning_pairs_count * sizeof(kerning_pair))) {
+                    return font_table::kerning;
+                }
+
+                return font_table::other;
+            }
+
+            const font *font_{nullptr};
+            uint32_t bitmap_size_{0};
+            table_set stats_{};
+            table_set font_stats_{};
+        };
+
+        // Drop-in replacement for a mem_reader policy that attributes every read to
+        // the font table it hits. Call profile().attach(&font) before rendering and
+        // profile().reset() before each string. Table entries are sized by the
+        // cost model they are printed with, not by the host layout.
+        class instrumented_reader {
+        public:
+            template<class T>
+            static inline const T &read_mem(const void *ptr) {
+                profile().record(ptr, entry_of<T>::value, sizeof(T));
+                return *reinterpret_cast<const T *>(ptr);
+            }
+
+            static read_profile &profile() {
+                static read_profile instance;
+                return instance;
+            }
+        };
+    }
+}
+
+#endif
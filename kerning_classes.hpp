@@ -0,0 +1,19 @@
+#ifndef ZOAL_FONT_GENERATOR_KERNING_CLASSES_HPP
+#define ZOAL_FONT_GENERATOR_KERNING_CLASSES_HPP
+
+#include "types.hpp"
+
+namespace zoal {
+    namespace text {
+        // O(1) kerning lookup by glyph index (code - range.start + range.base)
+        // for fonts generated with --kern-classes.
+        template<class Reader>
+        inline int8_t class_kerning(const kerning_classes *k, uint16_t first_glyph, uint16_t second_glyph) {
+            uint8_t l = Reader::template read_mem<uint8_t>(k->left + first_glyph);
+            uint8_t r = Reader::template read_mem<uint8_t>(k->right + second_glyph);
+            return Reader::template read_mem<int8_t>(k->matrix + l * k->right_count + r);
+        }
+    }
+}
+
+#endif
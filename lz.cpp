@@ -0,0 +1,103 @@
+#include "lz.h"
+
+static const int min_match = 4;
+static const int hash_bits = 12;
+static const int max_chain = 256;
+static const size_t max_offset = 0xFFFF;
+// LZ4 end of block rules: the last match starts at least 12 bytes before the
+// end and the last 5 bytes are literals.
+static const size_t match_start_limit = 12;
+static const size_t last_literals = 5;
+
+static uint32_t hash4(const uint8_t *p) {
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+static void put_length(std::vector<uint8_t> &out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back((uint8_t) length);
+}
+
+static void put_sequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literals_count, size_t offset, size_t match) {
+    uint8_t token = (uint8_t) ((literals_count < 15 ? literals_count : 15) << 4);
+    if (match > 0) {
+        size_t m = match - min_match;
+        token |= m < 15 ? m : 15;
+    }
+
+    out.push_back(token);
+    if (literals_count >= 15) {
+        put_length(out, literals_count - 15);
+    }
+    out.insert(out.end(), literals, literals + literals_count);
+
+    if (match > 0) {
+        out.push_back(offset & 0xFF);
+        out.push_back((offset >> 8) & 0xFF);
+        if (match - min_match >= 15) {
+            put_length(out, match - min_match - 15);
+        }
+    }
+}
+
+std::vector<uint8_t> lz_compress(const std::vector<uint8_t> &src) {
+    std::vector<uint8_t> out;
+    std::vector<int32_t> head(1 << hash_bits, -1);
+    std::vector<int32_t> chain(src.size(), -1);
+    const uint8_t *data = src.data();
+    const size_t size = src.size();
+
+    auto insert = [&](size_t pos) {
+        if (pos + min_match <= size) {
+            uint32_t h = hash4(data + pos);
+            chain[pos] = head[h];
+            head[h] = (int32_t) pos;
+        }
+    };
+
+    const size_t match_end = size > last_literals ? size - last_literals : 0;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + match_start_limit <= size) {
+        size_t best = 0;
+        size_t best_offset = 0;
+        int32_t candidate = head[hash4(data + pos)];
+        for (int depth = 0; candidate >= 0 && depth < max_chain; depth++, candidate = chain[candidate]) {
+            size_t offset = pos - candidate;
+            if (offset > max_offset) {
+                break;
+            }
+
+            size_t length = 0;
+            while (pos + length < match_end && data[candidate + length] == data[pos + length]) {
+                length++;
+            }
+
+            if (length > best) {
+                best = length;
+                best_offset = offset;
+            }
+        }
+
+        if (best < (size_t) min_match) {
+            insert(pos);
+            pos++;
+            continue;
+        }
+
+        put_sequence(out, data + anchor, pos - anchor, best_offset, best);
+        for (size_t i = 0; i < best; i++) {
+            insert(pos + i);
+        }
+        pos += best;
+        anchor = pos;
+    }
+
+    // The block always ends with a literals-only sequence (possibly empty).
+    put_sequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
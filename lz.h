@@ -0,0 +1,13 @@
+#ifndef ZOAL_FONT_GENERATOR_LZ_H
+#define ZOAL_FONT_GENERATOR_LZ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compresses src into the LZ4 block format decoded by zoal::text::lz_decompress
+// (lz_font.hpp), following the end of block rules so stock LZ4 decoders accept
+// it too. Offline encoder: hash chains, longest match within 64 KiB.
+std::vector<uint8_t> lz_compress(const std::vector<uint8_t> &src);
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef ZOAL_FONT_GENERATOR_LZ_FONT_HPP
+#define ZOAL_FONT_GENERATOR_LZ_FONT_HPP
+
+#include "types.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zoal {
+    namespace text {
+        static constexpr size_t packed_glyph_size = 9;
+
+        // Decodes an LZ4 block read through Reader into dst; returns the number of
+        // bytes written or 0 if the block is corrupt or does not fit capacity.
+        template<class Reader>
+        size_t lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+            const uint8_t *end = src + size;
+            uint8_t *out = dst;
+            uint8_t *out_end = dst + capacity;
+
+            auto length = [&src, end](size_t value) -> size_t {
+                if (value != 15) {
+                    return value;
+                }
+
+                uint8_t b = 255;
+                while (b == 255 && src < end) {
+                    b = Reader::template read_mem<uint8_t>(src++);
+                    value += b;
+                }
+                return value;
+            };
+
+            while (src < end) {
+                uint8_t token = Reader::template read_mem<uint8_t>(src++);
+                size_t literals = length(token >> 4);
+                if (literals > (size_t) (end - src) || literals > (size_t) (out_end - out)) {
+                    return 0;
+                }
+
+                while (literals--) {
+                    *out++ = Reader::template read_mem<uint8_t>(src++);
+                }
+
+                if (src == end) {
+                    break;
+                }
+
+                if (end - src < 2) {
+                    return 0;
+                }
+
+                size_t offset = Reader::template read_mem<uint8_t>(src) | (Reader::template read_mem<uint8_t>(src + 1) << 8);
+                src += 2;
+                size_t match = length(token & 0x0F) + 4;
+                if (offset == 0 || offset > (size_t) (out - dst) || match > (size_t) (out_end - out)) {
+                    return 0;
+                }
+
+                const uint8_t *from = out - offset;
+                while (match--) {
+                    *out++ = *from++;
+                }
+            }
+
+            return out - dst;
+        }
+
+        // RAM needed by unpack_font: the glyph table followed by the bitmap.
+        inline size_t unpacked_size(const packed_font &p) {
+            return p.glyphs_count * sizeof(glyph) + p.bitmap_size;
+        }
+
+        // Rebuilds a regular font in ram (unpacked_size bytes, aligned for glyph).
+        // The payload is decoded in place so that the bitmap lands at its final
+        // position, then the packed descriptors are widened front to back; every
+        // glyph written ends before the descriptor that is read next. Ranges and
+        // kerning pairs keep pointing at the packed font's tables; only the
+        // compressed payload is read through Reader.
+        template<class Reader>
+        bool unpack_font(const packed_font &p, void *ram, size_t ram_size, font &out) {
+            const size_t count = p.glyphs_count;
+            const size_t bitmap_size = p.bitmap_size;
+            const size_t table_size = count * sizeof(glyph);
+            const size_t payload_size = count * packed_glyph_size + bitmap_size;
+            if (ram_size < table_size + bitmap_size) {
+                return false;
+            }
+
+            auto base = static_cast<uint8_t *>(ram);
+            uint8_t *payload = base + table_size - count * packed_glyph_size;
+            if (lz_decompress<Reader>(p.data, p.data_size, payload, payload_size) != payload_size) {
+                return false;
+            }
+
+            auto glyphs = static_cast<glyph *>(ram);
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t *d = payload + i * packed_glyph_size;
+                glyph g;
+                g.bitmap_offset = (uint32_t) d[0] | ((uint32_t) d[1] << 8) | ((uint32_t) d[2] << 16) | ((uint32_t) d[3] << 24);
+                g.width = d[4];
+                g.height = d[5];
+                g.x_advance = d[6];
+                g.x_offset = (int8_t) d[7];
+                g.y_offset = (int8_t) d[8];
+                glyphs[i] = g;
+            }
+
+            out.y_advance = p.y_advance;
+            out.bitmap = base + table_size;
+            out.glyphs = glyphs;
+            out.glyphs_count = (uint16_t) count;
+            out.ranges = p.ranges;
+            out.ranges_count = p.ranges_count;
+            out.kerning_pairs = p.kerning_pairs;
+            out.kerning_pairs_count = p.kerning_pairs_count;
+            out.bits_per_pixel = p.bits_per_pixel;
+            return true;
+        }
+    }
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <map>
 #include "types.hpp"
 #include "font_generator.h"
+#include "server.h"
 
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
@@ -30,6 +31,17 @@ int main(int argc, char *argv[]) {
                 ("size,s", po::value<int>(), "font size")
                 ("progmem", "use PROGMEM")
                 ("kern", "use kerning")
+                ("kern-classes", "emit kerning as a class matrix instead of a pair list")
+                ("stream", "write glyphs incrementally instead of keeping the whole font in memory")
+                ("window", po::value<size_t>(), "stream window in bytes (default 65536)")
+                ("split", "write every range into its own translation unit")
+                ("flash-page", po::value<int>(), "write a page-aligned external flash image with the given page size")
+                ("rotate", po::value<int>(), "rotate glyphs clockwise: 0, 90, 180 or 270")
+                ("digits", "add a fixed-advance digit strip for fast number rendering")
+                ("lz", "compress glyphs and bitmap as a whole, to be unpacked into RAM at boot")
+                ("bpp", po::value<int>(), "bits per pixel: 1 (mono), 2 or 4 (antialiased)")
+                ("dither", "use ordered dithering when quantizing antialiased glyphs")
+                ("server", "serve newline-delimited JSON jobs from stdin")
                 ("ranges,r", po::value<std::vector<std::string>>(), "unicode char ranges: 0x0020-0x007")
                 ("name,n", po::value<std::string>(), "output font name");
 
@@ -42,6 +54,11 @@ int main(int argc, char *argv[]) {
             return 0;
         }
 
+        if (vm.count("server")) {
+            generator_server server;
+            return server.run(std::cin, std::cout);
+        }
+
         if (!vm.count("font")) {
             std::cout << "Missing font argument parameter" << std::endl;
             return 0;
@@ -68,6 +85,75 @@ int main(int argc, char *argv[]) {
         if (vm.count("kern")) {
             gen.use_kern = true;
         }
+        if (vm.count("kern-classes")) {
+            gen.use_kern_classes = true;
+        }
+        if (vm.count("stream")) {
+            gen.use_stream = true;
+        }
+        if (vm.count("split")) {
+            gen.use_split = true;
+        }
+        if (vm.count("stream") && vm.count("split")) {
+            std::cout << "--stream and --split can't be combined" << std::endl;
+            return 0;
+        }
+        if (vm.count("split") && (vm.count("kern-classes") || vm.count("digits"))) {
+            std::cout << "--split can't be combined with --kern-classes or --digits" << std::endl;
+            return 0;
+        }
+        if (vm.count("flash-page")) {
+            int page = vm["flash-page"].as<int>();
+            if (page < 8 || page > 0xFFFF || (page & (page - 1)) != 0) {
+                std::cout << "Flash page size must be a power of two between 8 and 32768" << std::endl;
+                return 0;
+            }
+            if (vm.count("stream") || vm.count("split")) {
+                std::cout << "--flash-page can't be combined with --stream or --split" << std::endl;
+                return 0;
+            }
+            if (vm.count("kern") || vm.count("kern-classes") || vm.count("digits")) {
+                std::cout << "--flash-page can't be combined with --kern, --kern-classes or --digits" << std::endl;
+                return 0;
+            }
+            gen.flash_page = page;
+        }
+        if (vm.count("rotate")) {
+            int rotation = vm["rotate"].as<int>();
+            if (rotation != 0 && rotation != 90 && rotation != 180 && rotation != 270) {
+                std::cout << "Rotation must be 0, 90, 180 or 270" << std::endl;
+                return 0;
+            }
+            gen.rotation = rotation;
+        }
+        if (vm.count("digits")) {
+            if (gen.rotation != 0) {
+                std::cout << "--digits can't be combined with --rotate" << std::endl;
+                return 0;
+            }
+            gen.use_digits = true;
+        }
+        if (vm.count("bpp")) {
+            int bpp = vm["bpp"].as<int>();
+            if (bpp != 1 && bpp != 2 && bpp != 4) {
+                std::cout << "Bits per pixel must be 1, 2 or 4" << std::endl;
+                return 0;
+            }
+            gen.bpp = bpp;
+        }
+        if (vm.count("dither")) {
+            gen.use_dither = true;
+        }
+        if (vm.count("lz")) {
+            gen.use_lz = true;
+        }
+        if (vm.count("lz") && (vm.count("stream") || vm.count("split") || vm.count("flash-page"))) {
+            std::cout << "--lz can't be combined with --stream, --split or --flash-page" << std::endl;
+            return 0;
+        }
+        if (vm.count("window")) {
+            gen.stream_window = vm["window"].as<size_t>();
+        }
 
         gen.generate_fonts_file();
     } catch (std::exception &exc) {
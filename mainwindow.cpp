@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 
 #include "./ui_mainwindow.h"
+#include "simulator.h"
 
 #include <QTime>
 #include <QTimer>
@@ -9,22 +10,51 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow) {
     ui->setupUi(this);
+
+    auto timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &MainWindow::process_events);
+    timer->start(33);
 }
 
 MainWindow::~MainWindow() {
     delete ui;
 }
 
+void MainWindow::attach(simulator *s) {
+    sim = s;
+}
+
 void MainWindow::on_ccwButton_clicked() {
+    if (sim != nullptr) {
+        sim->post(input_event::rotate_ccw);
+    }
 }
 
 void MainWindow::on_cwButton_clicked() {
+    if (sim != nullptr) {
+        sim->post(input_event::rotate_cw);
+    }
 }
 
 void MainWindow::on_pressButton_clicked() {
+    if (sim != nullptr) {
+        sim->post(input_event::press);
+    }
 }
 
 void MainWindow::process_events() {
+    if (sim == nullptr) {
+        return;
+    }
+
+    auto stats = sim->stats();
+    ui->oledScreen->setSource(sim->front());
+    ui->oledScreen->update();
+    ui->statusbar->showMessage(QString("frame %1: render %2 us (max %3 us), %4 pixels touched")
+                                       .arg(stats.frame)
+                                       .arg(stats.render_us)
+                                       .arg(stats.max_render_us)
+                                       .arg(stats.pixels_touched));
 }
 
 void MainWindow::on_renderButton_clicked() {
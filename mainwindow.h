@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+class simulator;
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
@@ -15,6 +17,8 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    void attach(simulator *sim);
+
 private slots:
     void on_ccwButton_clicked();
 
@@ -26,6 +30,7 @@ private slots:
 
 private:
     Ui::MainWindow *ui;
+    simulator *sim{nullptr};
     void process_events();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,106 @@
+#ifndef ZOAL_FONT_GENERATOR_NUMBER_RENDERER_HPP
+#define ZOAL_FONT_GENERATOR_NUMBER_RENDERER_HPP
+
+#include "types.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zoal {
+    namespace gfx {
+        // Draws numbers from a digit_strip (GenFont --digits) straight into an
+        // SH1106-style page buffer of Width x Pages bytes. Every cell is a plain
+        // byte copy, and cells that show the same character as on the previous draw
+        // are skipped. Columns and pages outside the buffer are clipped.
+        template<class Reader, size_t Width = 128, size_t MaxCells = 8, size_t Pages = 8>
+        class number_renderer {
+        public:
+            number_renderer(uint8_t *canvas, const zoal::text::digit_strip *strip)
+                : canvas_(canvas)
+                , strip_(strip) {
+                invalidate();
+            }
+
+            number_renderer &position(int x, int page) {
+                x_ = x;
+                page_ = page;
+                invalidate();
+                return *this;
+            }
+
+            // Characters outside "0123456789.-:%" are drawn as blanks. Cells past
+            // the end of text are blanked only if an earlier draw wrote them.
+            // Returns the number of cells that were written.
+            int draw(const char *text) {
+                int written = 0;
+                size_t i = 0;
+                for (; i < MaxCells && text[i]; i++) {
+                    if (shown_[i] != text[i]) {
+                        blit(i, cell_index(text[i]));
+                        shown_[i] = text[i];
+                        written++;
+                    }
+                }
+
+                for (; i < MaxCells && shown_[i]; i++) {
+                    blit(i, -1);
+                    shown_[i] = 0;
+                    written++;
+                }
+                return written;
+            }
+
+            // Forgets what was drawn, e.g. after the canvas was cleared: the next
+            // draw writes every cell of its text and leaves the cells after it alone.
+            void invalidate() {
+                for (size_t i = 0; i < MaxCells; i++) {
+                    shown_[i] = 0;
+                }
+            }
+
+        private:
+            static int cell_index(char ch) {
+                switch (ch) {
+                    case '.':
+                        return 10;
+                    case '-':
+                        return 11;
+                    case ':':
+                        return 12;
+                    case '%':
+                        return 13;
+                    default:
+                        return ch >= '0' && ch <= '9' ? ch - '0' : -1;
+                }
+            }
+
+            void blit(size_t cell, int index) {
+                const int advance = strip_->advance;
+                const int left = x_ + (int) cell * advance;
+                const uint8_t *src = strip_->bitmap + (index < 0 ? 0 : index) * strip_->pages * advance;
+                for (int p = 0; p < strip_->pages; p++) {
+                    if (page_ + p < 0 || page_ + p >= (int) Pages) {
+                        continue;
+                    }
+
+                    uint8_t *row = canvas_ + (page_ + p) * Width;
+                    for (int c = 0; c < advance; c++) {
+                        if (left + c < 0 || left + c >= (int) Width) {
+                            continue;
+                        }
+
+                        row[left + c] = index < 0 ? 0 : Reader::template read_mem<uint8_t>(src + p * advance + c);
+                    }
+                }
+            }
+
+            uint8_t *canvas_;
+            const zoal::text::digit_strip *strip_;
+            int x_{0};
+            int page_{0};
+            char shown_[MaxCells];
+        };
+    }
+}
+
+#endif
@@ -45,7 +45,12 @@ uint8_t canvas[1024] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 OledScreen::OledScreen(QWidget *parent)
-    : QWidget(parent) {}
+    : QWidget(parent)
+    , source(canvas) {}
+
+void OledScreen::setSource(const uint8_t *data) {
+    source = data;
+}
 
 void OledScreen::drawPixel(QPainter &qp, int x, int y) {
     QColor color(0x00FF00);
@@ -70,7 +75,7 @@ void OledScreen::paintEvent(QPaintEvent *event) {
 void OledScreen::drawScreen(QPainter &qp) {
     int size = sizeof(canvas);
     for (int i = 0; i < size; i++) {
-        auto b = canvas[i];
+        auto b = source[i];
         int x = i % 128;
         int page = i / 128;
         int yp = page << 3;
@@ -9,10 +9,13 @@ class OledScreen : public QWidget
     Q_OBJECT
 public:
     explicit OledScreen(QWidget *parent = nullptr);
+    void setSource(const uint8_t *data);
 protected:
     static void drawPixel(QPainter &qp, int x, int y);
     void paintEvent(QPaintEvent *event);
-    static void drawScreen(QPainter &qp);
+    void drawScreen(QPainter &qp);
+private:
+    const uint8_t *source;
 signals:
 
 };
@@ -0,0 +1,94 @@
+#include "pixel_pack.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXEL_PACK_SSE2 1
+#endif
+
+static const uint8_t bayer[4][4] = {
+        {8, 136, 40, 168},
+        {200, 72, 232, 104},
+        {56, 184, 24, 152},
+        {248, 120, 216, 88}};
+
+static const uint8_t rounding[4] = {128, 128, 128, 128};
+
+const uint8_t *dither_row(int y, bool dither) {
+    return dither ? bayer[y & 3] : rounding;
+}
+
+static void pack_scalar(const uint8_t *src, int from, int width, int bpp, const uint8_t *thresholds, uint8_t *dst) {
+    const int levels = (1 << bpp) - 1;
+    for (int x = from; x < width; x++) {
+        int q = (src[x] * levels + thresholds[x & 3]) >> 8;
+        int bit = x * bpp;
+        dst[bit >> 3] |= q << (8 - bpp - (bit & 7));
+    }
+}
+
+#ifdef PIXEL_PACK_SSE2
+static uint8_t reverse_bits(uint8_t v) {
+    v = (uint8_t) ((v & 0xF0) >> 4 | (v & 0x0F) << 4);
+    v = (uint8_t) ((v & 0xCC) >> 2 | (v & 0x33) << 2);
+    return (uint8_t) ((v & 0xAA) >> 1 | (v & 0x55) << 1);
+}
+
+// Merges byte pairs of every 16-bit lane: (low << shift) | high.
+static inline __m128i merge_pairs(__m128i v, int shift) {
+    const __m128i low_mask = _mm_set1_epi16(0x00FF);
+    __m128i low = _mm_slli_epi16(_mm_and_si128(v, low_mask), shift);
+    __m128i high = _mm_srli_epi16(v, 8);
+    return _mm_or_si128(low, high);
+}
+#endif
+
+void pack_row(const uint8_t *src, int width, int bpp, const uint8_t *thresholds, uint8_t *dst) {
+    memset(dst, 0, (width * bpp + 7) >> 3);
+
+    int x = 0;
+#ifdef PIXEL_PACK_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i levels = _mm_set1_epi16((short) ((1 << bpp) - 1));
+    const __m128i t = _mm_setr_epi16(thresholds[0], thresholds[1], thresholds[2], thresholds[3],
+                                     thresholds[0], thresholds[1], thresholds[2], thresholds[3]);
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, levels), t), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, levels), t), 8);
+        __m128i q = _mm_packus_epi16(lo, hi);
+
+        uint8_t *out = dst + ((x * bpp) >> 3);
+        switch (bpp) {
+            case 1: {
+                int mask = _mm_movemask_epi8(_mm_slli_epi16(q, 7));
+                out[0] = reverse_bits((uint8_t) mask);
+                out[1] = reverse_bits((uint8_t) (mask >> 8));
+                break;
+            }
+            case 2: {
+                __m128i nibbles = _mm_packus_epi16(merge_pairs(q, 2), zero);
+                __m128i bytes = _mm_packus_epi16(merge_pairs(nibbles, 4), zero);
+                int packed = _mm_cvtsi128_si32(bytes);
+                memcpy(out, &packed, 4);
+                break;
+            }
+            default: {
+                __m128i bytes = _mm_packus_epi16(merge_pairs(q, 4), zero);
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(out), bytes);
+                break;
+            }
+        }
+    }
+#endif
+
+    pack_scalar(src, x, width, bpp, thresholds, dst);
+}
+
+void pack_row_scalar(const uint8_t *src, int width, int bpp, const uint8_t *thresholds, uint8_t *dst) {
+    memset(dst, 0, (width * bpp + 7) >> 3);
+    pack_scalar(src, 0, width, bpp, thresholds, dst);
+}
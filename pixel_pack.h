@@ -0,0 +1,19 @@
+#ifndef ZOAL_FONT_GENERATOR_PIXEL_PACK_H
+#define ZOAL_FONT_GENERATOR_PIXEL_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Ordered dithering thresholds for output row y (4 values repeating along x),
+// or the plain rounding threshold when dithering is off.
+const uint8_t *dither_row(int y, bool dither);
+
+// Quantizes 8-bit coverage to 1, 2 or 4 bits per pixel with
+// q = (p * (levels - 1) + threshold) >> 8 and packs the levels MSB-first into
+// (width * bpp + 7) / 8 bytes. Uses SSE2 when available.
+void pack_row(const uint8_t *src, int width, int bpp, const uint8_t *thresholds, uint8_t *dst);
+
+// Same as pack_row without SIMD; the reference the vector path is tested against.
+void pack_row_scalar(const uint8_t *src, int width, int bpp, const uint8_t *thresholds, uint8_t *dst);
+
+#endif
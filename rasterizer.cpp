@@ -0,0 +1,138 @@
+#include "rasterizer.h"
+
+rasterizer::rasterizer(unsigned max_faces, unsigned max_sizes, FT_ULong max_bytes) {
+    if (FT_Init_FreeType(&library)) {
+        library = nullptr;
+        return;
+    }
+
+    if (FTC_Manager_New(library, max_faces, max_sizes, max_bytes, request_face, nullptr, &manager)
+        || FTC_CMapCache_New(manager, &cmaps)
+        || FTC_SBitCache_New(manager, &sbits)
+        || FTC_ImageCache_New(manager, &images)) {
+        if (manager != nullptr) {
+            FTC_Manager_Done(manager);
+            manager = nullptr;
+        }
+    }
+}
+
+rasterizer::~rasterizer() {
+    release_glyph();
+
+    if (manager != nullptr) {
+        FTC_Manager_Done(manager);
+    }
+
+    if (library != nullptr) {
+        FT_Done_FreeType(library);
+    }
+}
+
+bool rasterizer::ready() const {
+    return manager != nullptr;
+}
+
+FT_Error rasterizer::request_face(FTC_FaceID face_id, FT_Library library, FT_Pointer, FT_Face *face) {
+    auto path = static_cast<const std::string *>(face_id);
+    return FT_New_Face(library, path->c_str(), 0, face);
+}
+
+FTC_FaceID rasterizer::face_id(const std::string &path) {
+    for (auto &p : paths) {
+        if (p == path) {
+            return (FTC_FaceID) &p;
+        }
+    }
+
+    paths.push_back(path);
+    return (FTC_FaceID) &paths.back();
+}
+
+FT_Face rasterizer::face(const std::string &path, uint8_t size) {
+    if (!ready()) {
+        return nullptr;
+    }
+
+    FTC_ScalerRec scaler{face_id(path), 0, size, 1, 0, 0};
+    FT_Size ft_size;
+    if (FTC_Manager_LookupSize(manager, &scaler, &ft_size)) {
+        return nullptr;
+    }
+
+    return ft_size->face;
+}
+
+void rasterizer::release_glyph() {
+    if (large_glyph != nullptr) {
+        FT_Done_Glyph(large_glyph);
+        large_glyph = nullptr;
+    }
+}
+
+bool rasterizer::render(const std::string &path, uint8_t size, FT_ULong code, FT_Render_Mode mode, rendered_glyph &out) {
+    if (!ready()) {
+        return false;
+    }
+
+    release_glyph();
+
+    FTC_FaceID id = face_id(path);
+    FTC_ScalerRec scaler{id, 0, size, 1, 0, 0};
+    FT_UInt index = FTC_CMapCache_Lookup(cmaps, id, -1, code);
+    FT_Int32 flags = FT_LOAD_DEFAULT | FT_LOAD_RENDER;
+    if (mode == FT_RENDER_MODE_MONO) {
+        flags |= FT_LOAD_MONOCHROME;
+    }
+
+    if (rendered.insert(std::make_tuple(id, size, flags, index)).second) {
+        misses_++;
+    } else {
+        hits_++;
+    }
+
+    FTC_SBit sbit;
+    if (FTC_SBitCache_LookupScaler(sbits, &scaler, flags, index, &sbit, nullptr)) {
+        return false;
+    }
+
+    // Small bitmap cache refuses glyphs that don't fit in 8-bit metrics.
+    if (sbit->buffer != nullptr || sbit->width != 255) {
+        out.width = sbit->width;
+        out.rows = sbit->height;
+        out.pitch = sbit->pitch;
+        out.left = sbit->left;
+        out.top = sbit->top;
+        out.advance = sbit->xadvance;
+        out.buffer = sbit->buffer;
+        return true;
+    }
+
+    FT_Glyph glyph;
+    if (FTC_ImageCache_LookupScaler(images, &scaler, FT_LOAD_DEFAULT, index, &glyph, nullptr)) {
+        return false;
+    }
+
+    if (FT_Glyph_Copy(glyph, &large_glyph) || FT_Glyph_To_Bitmap(&large_glyph, mode, nullptr, 1)) {
+        release_glyph();
+        return false;
+    }
+
+    auto bitmap_glyph = reinterpret_cast<FT_BitmapGlyph>(large_glyph);
+    out.width = bitmap_glyph->bitmap.width;
+    out.rows = bitmap_glyph->bitmap.rows;
+    out.pitch = bitmap_glyph->bitmap.pitch;
+    out.left = bitmap_glyph->left;
+    out.top = bitmap_glyph->top;
+    out.advance = glyph->advance.x >> 16;
+    out.buffer = bitmap_glyph->bitmap.buffer;
+    return true;
+}
+
+uint64_t rasterizer::hits() const {
+    return hits_;
+}
+
+uint64_t rasterizer::misses() const {
+    return misses_;
+}
@@ -0,0 +1,64 @@
+#ifndef ZOAL_FONT_GENERATOR_RASTERIZER_H
+#define ZOAL_FONT_GENERATOR_RASTERIZER_H
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_CACHE_H
+#include FT_GLYPH_H
+
+#include <cstdint>
+#include <list>
+#include <set>
+#include <string>
+#include <tuple>
+
+struct rendered_glyph {
+    int width;
+    int rows;
+    int pitch;
+    int left;
+    int top;
+    int advance;
+    const uint8_t *buffer;
+};
+
+// Shared FreeType rasterization service built on the FreeType cache subsystem.
+// Faces, sizes, charmaps and rendered bitmaps are cached by FTC_Manager keyed by
+// (face, pixel size, render mode), so repeated and overlapping runs in the GUI or
+// in server mode skip outline loading, hinting and rendering.
+class rasterizer {
+public:
+    explicit rasterizer(unsigned max_faces = 8, unsigned max_sizes = 16, FT_ULong max_bytes = 16 * 1024 * 1024);
+    ~rasterizer();
+
+    bool ready() const;
+
+    // Returns the cached face with the requested pixel size activated, or nullptr.
+    FT_Face face(const std::string &path, uint8_t size);
+
+    // Glyph bitmap stays valid until the next render() call.
+    bool render(const std::string &path, uint8_t size, FT_ULong code, FT_Render_Mode mode, rendered_glyph &out);
+
+    // FTC does not report cache statistics; a hit is a render() of a glyph this
+    // rasterizer has rendered before (FTC may have evicted it since).
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    static FT_Error request_face(FTC_FaceID face_id, FT_Library library, FT_Pointer data, FT_Face *face);
+    FTC_FaceID face_id(const std::string &path);
+    void release_glyph();
+
+    FT_Library library{nullptr};
+    FTC_Manager manager{nullptr};
+    FTC_CMapCache cmaps{nullptr};
+    FTC_SBitCache sbits{nullptr};
+    FTC_ImageCache images{nullptr};
+    std::list<std::string> paths;
+    FT_Glyph large_glyph{nullptr};
+    std::set<std::tuple<FTC_FaceID, uint8_t, FT_Int32, FT_UInt>> rendered;
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+};
+
+#endif
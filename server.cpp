@@ -0,0 +1,97 @@
+#include "server.h"
+#include "font_generator.h"
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+int generator_server::run(std::istream &in, std::ostream &out) {
+    if (!raster.ready()) {
+        return -1;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        process(line, out);
+    }
+
+    return 0;
+}
+
+void generator_server::process(const std::string &line, std::ostream &out) {
+    namespace pt = boost::property_tree;
+    auto begin = std::chrono::steady_clock::now();
+    pt::ptree job;
+    pt::ptree response;
+
+    try {
+        std::istringstream is(line);
+        pt::read_json(is, job);
+        response.put("id", job.get<std::string>("id", ""));
+
+        font_generator gen;
+        gen.raster = &raster;
+        gen.font_path = job.get<std::string>("font");
+        gen.font_size = job.get<int>("size", gen.font_size);
+        gen.font_name = job.get<std::string>("name", gen.font_name);
+        gen.use_progmem = job.get<bool>("progmem", false);
+        gen.use_kern = job.get<bool>("kern", false);
+        gen.use_lz = job.get<bool>("lz", false);
+        gen.rotation = job.get<uint16_t>("rotate", 0);
+        if (gen.rotation % 90 != 0 || gen.rotation > 270) {
+            throw std::runtime_error("rotate must be 0, 90, 180 or 270");
+        }
+
+        gen.bpp = job.get<int>("bpp", 1);
+        gen.use_dither = job.get<bool>("dither", false);
+        if (gen.bpp != 1 && gen.bpp != 2 && gen.bpp != 4) {
+            throw std::runtime_error("bpp must be 1, 2 or 4");
+        }
+        for (auto &r : job.get_child("ranges")) {
+            gen.font_ranges.push_back(r.second.get_value<std::string>());
+        }
+
+        FT_Face face = raster.face(gen.font_path, gen.font_size);
+        if (face == nullptr) {
+            throw std::runtime_error("can't open font " + gen.font_path);
+        }
+
+        auto hits = raster.hits();
+        auto misses = raster.misses();
+        if (gen.rasterize_font(face) != 0) {
+            throw std::runtime_error("can't rasterize font " + gen.font_path);
+        }
+
+        std::ostringstream cpp;
+        std::ostringstream hpp;
+        gen.write_src(cpp, face);
+        gen.write_header(hpp);
+
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        response.put("status", "ok");
+        response.put("glyphs", gen.glyphs.size());
+        response.put("bitmap_size", gen.buffer.size());
+        response.put("cache_hits", raster.hits() - hits);
+        response.put("cache_misses", raster.misses() - misses);
+        if (gen.use_lz) {
+            response.put("lz_size", gen.lz_buffer.size());
+            response.put("lz_decode_us", gen.lz_decode_us);
+        }
+        response.put("elapsed_us", std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        response.put("cpp", cpp.str());
+        response.put("hpp", hpp.str());
+    } catch (std::exception &exc) {
+        response.put("status", "error");
+        response.put("message", exc.what());
+    }
+
+    pt::write_json(out, response, false);
+    out.flush();
+}
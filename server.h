@@ -0,0 +1,23 @@
+#ifndef ZOAL_FONT_GENERATOR_SERVER_H
+#define ZOAL_FONT_GENERATOR_SERVER_H
+
+#include "rasterizer.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Long-running generator: reads one JSON job per line and answers with one JSON
+// line carrying the generated sources. Faces, sizes and rendered glyphs stay
+// warm in the shared rasterizer between jobs.
+class generator_server {
+public:
+    int run(std::istream &in, std::ostream &out);
+
+private:
+    void process(const std::string &line, std::ostream &out);
+
+    rasterizer raster;
+};
+
+#endif
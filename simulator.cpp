@@ -0,0 +1,89 @@
+#include "simulator.h"
+
+#include <cstring>
+
+simulator::simulator(render_fn fn)
+    : render(std::move(fn)) {}
+
+simulator::~simulator() {
+    stop();
+}
+
+void simulator::start(std::chrono::milliseconds period) {
+    if (running.exchange(true)) {
+        return;
+    }
+
+    worker = std::thread(&simulator::loop, this, period);
+}
+
+void simulator::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    worker.join();
+}
+
+void simulator::post(input_event event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(event);
+}
+
+const uint8_t *simulator::front() {
+    if (ready.load() & fresh) {
+        front_index = ready.exchange(front_index) & ~fresh;
+    }
+    return buffers[front_index];
+}
+
+frame_stats simulator::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+void simulator::loop(std::chrono::milliseconds period) {
+    auto next = std::chrono::steady_clock::now();
+    render_frame(input_event::none);
+
+    while (running) {
+        next += period;
+        std::this_thread::sleep_until(next);
+
+        std::deque<input_event> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.swap(events);
+        }
+
+        if (pending.empty()) {
+            render_frame(input_event::none);
+        }
+
+        for (auto event : pending) {
+            render_frame(event);
+        }
+    }
+}
+
+void simulator::render_frame(input_event event) {
+    uint8_t *canvas = buffers[back];
+    memcpy(canvas, previous, canvas_size);
+
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t touched = render(canvas, event);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    if (touched == 0) {
+        return;
+    }
+
+    memcpy(previous, canvas, canvas_size);
+    back = ready.exchange(back | fresh) & ~fresh;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto us = (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    current.frame++;
+    current.render_us = us;
+    current.max_render_us = us > current.max_render_us ? us : current.max_render_us;
+    current.pixels_touched = touched;
+}
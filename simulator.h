@@ -0,0 +1,93 @@
+#ifndef ZOAL_FONT_GENERATOR_SIMULATOR_H
+#define ZOAL_FONT_GENERATOR_SIMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+enum class input_event { none, rotate_ccw, rotate_cw, press };
+
+struct frame_stats {
+    uint32_t frame;
+    uint32_t render_us;
+    uint32_t max_render_us;
+    uint32_t pixels_touched; // pixel writes reported by the render callback, overdraw included
+};
+
+// Runs firmware UI code on a worker thread. Each frame is rendered into a back
+// canvas that starts as a copy of the previous frame, like a real framebuffer,
+// and is then published with a single atomic exchange. A third buffer lets the
+// GUI hold the front canvas while the next frame is being rendered. The render
+// callback returns the number of pixels it wrote (see counting_graphics); a
+// call that writes none is an idle tick and neither publishes nor updates stats.
+class simulator {
+public:
+    static constexpr size_t canvas_size = 1024;
+    using render_fn = std::function<uint32_t(uint8_t *canvas, input_event event)>;
+
+    explicit simulator(render_fn fn);
+    ~simulator();
+
+    void start(std::chrono::milliseconds period);
+    void stop();
+    void post(input_event event);
+
+    // Latest published frame; stays valid until the next call.
+    const uint8_t *front();
+    frame_stats stats();
+
+private:
+    static constexpr uint8_t fresh = 0x80;
+
+    void loop(std::chrono::milliseconds period);
+    void render_frame(input_event event);
+
+    render_fn render;
+    uint8_t buffers[3][canvas_size]{};
+    uint8_t previous[canvas_size]{};
+    uint8_t back{0};
+    uint8_t front_index{1};
+    std::atomic<uint8_t> ready{2};
+
+    std::mutex mutex;
+    std::deque<input_event> events;
+    frame_stats current{};
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
+
+// Forwards drawing to Graphics and counts the pixels written, so a render
+// callback can report what it touched.
+template<class Graphics>
+class counting_graphics {
+public:
+    using pixel_type = typename Graphics::pixel_type;
+
+    explicit counting_graphics(Graphics *g)
+        : graphics(g) {}
+
+    void pixel(int x, int y, pixel_type c) {
+        written++;
+        graphics->pixel(x, y, c);
+    }
+
+    void clear(pixel_type c) {
+        written += simulator::canvas_size * 8;
+        graphics->clear(c);
+    }
+
+    uint32_t writes() const {
+        return written;
+    }
+
+private:
+    Graphics *graphics;
+    uint32_t written{0};
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "instrumented_reader.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+using zoal::text::font_table;
+using zoal::text::instrumented_reader;
+
+static const uint8_t bitmap[] = {0xF0, 0x90, 0x90, 0xF0};
+static const zoal::text::glyph glyphs[] = {{0, 4, 4, 5, 0, -4}};
+static const zoal::text::unicode_range ranges[] = {{'A', 'A', 0}};
+static const zoal::text::kerning_pair pairs[] = {{'A', 'A', -1}};
+static const zoal::text::font font{8, bitmap, glyphs, 1, ranges, 1, pairs, 1, 1};
+
+// What a renderer reads for one glyph: range, kerning pair, descriptor, 4 rows.
+static void read_glyph() {
+    instrumented_reader::read_mem<zoal::text::unicode_range>(ranges);
+    instrumented_reader::read_mem<zoal::text::kerning_pair>(pairs);
+    auto &g = instrumented_reader::read_mem<zoal::text::glyph>(glyphs);
+    for (int y = 0; y < g.height; y++) {
+        instrumented_reader::read_mem<uint8_t>(bitmap + y);
+    }
+}
+
+static void test_entry_sizes_follow_model() {
+    auto &profile = instrumented_reader::profile();
+    profile.attach(&font);
+    read_glyph();
+
+    CHECK(profile.total().reads == 7);
+    CHECK(profile.stats(font_table::bitmap).device_bytes(zoal::text::avr_lpm) == 4);
+    CHECK(profile.stats(font_table::glyphs).device_bytes(zoal::text::avr_lpm) == 9);
+    CHECK(profile.stats(font_table::glyphs).device_bytes(zoal::text::cortex_m0_flash) == 12);
+    CHECK(profile.stats(font_table::kerning).device_bytes(zoal::text::avr_lpm) == 5);
+    CHECK(profile.stats(font_table::kerning).device_bytes(zoal::text::cortex_m0_flash) == 6);
+    CHECK(profile.total().device_bytes(zoal::text::avr_lpm) == 4 + 9 + 6 + 5);
+    CHECK(profile.total().device_bytes(zoal::text::cortex_m0_flash) == 4 + 12 + 6 + 6);
+    CHECK(profile.cycles(zoal::text::avr_lpm) == 7 * 4 + 24 * 3);
+    CHECK(profile.cycles(zoal::text::cortex_m0_flash) == 7 * 2 + 28 * 1);
+}
+
+static void test_font_totals() {
+    auto &profile = instrumented_reader::profile();
+    profile.attach(&font);
+    read_glyph();
+    profile.reset();
+    read_glyph();
+
+    CHECK(profile.total().reads == 7);
+    CHECK(profile.font_total().reads == 14);
+    CHECK(profile.font_cycles(zoal::text::cortex_m0_flash) == 2 * profile.cycles(zoal::text::cortex_m0_flash));
+}
+
+int main() {
+    test_entry_sizes_follow_model();
+    test_font_totals();
+    std::printf("instrumented_reader: ok\n");
+    return 0;
+}
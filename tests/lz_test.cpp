@@ -0,0 +1,98 @@
+#include "lz.h"
+#include "lz_font.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+class mem_reader {
+public:
+    template<class T>
+    static inline const T &read_mem(const void *ptr) {
+        return *reinterpret_cast<const T *>(ptr);
+    }
+};
+
+// Walks the sequences of a block and checks the LZ4 end of block rules: every
+// match starts at least 12 bytes before the end and ends at least 5 bytes before it.
+static void check_end_rules(const std::vector<uint8_t> &block, size_t size) {
+    size_t i = 0;
+    size_t out = 0;
+    auto length = [&block, &i](size_t value) {
+        if (value == 15) {
+            uint8_t b;
+            do {
+                b = block[i++];
+                value += b;
+            } while (b == 255);
+        }
+        return value;
+    };
+
+    while (i < block.size()) {
+        uint8_t token = block[i++];
+        size_t literals = length(token >> 4);
+        i += literals;
+        out += literals;
+        if (i == block.size()) {
+            break;
+        }
+
+        i += 2;
+        size_t match = length(token & 0x0F) + 4;
+        CHECK(out + 12 <= size);
+        CHECK(out + match + 5 <= size);
+        out += match;
+    }
+    CHECK(out == size);
+}
+
+static void round_trip(const std::vector<uint8_t> &src) {
+    auto block = lz_compress(src);
+    check_end_rules(block, src.size());
+
+    std::vector<uint8_t> decoded(src.size() + 1);
+    auto size = zoal::text::lz_decompress<mem_reader>(block.data(), block.size(), decoded.data(), decoded.size());
+    CHECK(size == src.size());
+    CHECK(std::memcmp(decoded.data(), src.data(), size) == 0);
+}
+
+int main() {
+    round_trip({});
+    round_trip({1, 2, 3});
+
+    // Short blocks must stay all literals.
+    for (size_t n = 0; n <= 16; n++) {
+        round_trip(std::vector<uint8_t>(n, 0));
+    }
+
+    // Runs that would otherwise match up to the last byte.
+    for (size_t n = 17; n <= 300; n += 7) {
+        round_trip(std::vector<uint8_t>(n, 0x5A));
+    }
+
+    // Glyph-like rows: repeated patterns with sparse noise and long literal runs.
+    std::vector<uint8_t> data;
+    uint32_t seed = 1;
+    for (int i = 0; i < 70000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data.push_back((seed >> 28) == 0 ? (uint8_t) (seed >> 20) : (uint8_t) (i % 24 < 12 ? 0x3C : 0x00));
+    }
+    round_trip(data);
+    for (auto &b : data) {
+        seed = seed * 1103515245u + 12345u;
+        b = (uint8_t) (seed >> 24);
+    }
+    round_trip(data);
+
+    std::printf("lz: ok\n");
+    return 0;
+}
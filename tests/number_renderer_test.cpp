@@ -0,0 +1,93 @@
+#include "number_renderer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+class mem_reader {
+public:
+    template<class T>
+    static inline const T &read_mem(const void *ptr) {
+        return *reinterpret_cast<const T *>(ptr);
+    }
+};
+
+// 14 cells of 2 columns x 2 pages; every byte of cell i is 0x10 + i.
+static uint8_t strip_bitmap[14 * 2 * 2];
+static const zoal::text::digit_strip strip{2, 2, -16, strip_bitmap};
+
+// 16 x 4 page canvas with guard bytes on both sides.
+static const size_t width = 16;
+static const size_t pages = 4;
+static uint8_t memory[width * pages + 32];
+static uint8_t *const canvas = memory + 16;
+
+using renderer = zoal::gfx::number_renderer<mem_reader, width, 8, pages>;
+
+static void reset() {
+    for (size_t i = 0; i < sizeof(strip_bitmap); i++) {
+        strip_bitmap[i] = (uint8_t) (0x10 + i / 4);
+    }
+    std::memset(memory, 0xEE, sizeof(memory));
+    std::memset(canvas, 0, width * pages);
+}
+
+static bool guards_intact() {
+    for (size_t i = 0; i < 16; i++) {
+        if (memory[i] != 0xEE || canvas[width * pages + i] != 0xEE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_first_draw_leaves_right_side_alone() {
+    reset();
+    std::memset(canvas, 0x55, width * pages);
+    renderer r(canvas, &strip);
+    CHECK(r.draw("12") == 2);
+    CHECK(canvas[0] == 0x11 && canvas[2] == 0x12 && canvas[width + 3] == 0x12);
+    CHECK(canvas[4] == 0x55 && canvas[width + 15] == 0x55);
+
+    // Only cells written earlier are blanked when the text gets shorter.
+    CHECK(r.draw("1") == 1);
+    CHECK(canvas[2] == 0 && canvas[width + 3] == 0 && canvas[4] == 0x55);
+    CHECK(r.draw("1") == 0);
+
+    r.position(8, 0);
+    CHECK(r.draw("3") == 1);
+    CHECK(canvas[8] == 0x13 && canvas[10] == 0x55);
+}
+
+static void test_clips_pages_and_columns() {
+    reset();
+    renderer r(canvas, &strip);
+    r.position(14, 3);
+    CHECK(r.draw("88") == 2);
+    CHECK(canvas[3 * width + 14] == 0x18 && canvas[3 * width + 15] == 0x18);
+    CHECK(guards_intact());
+
+    r.position(-1, -1);
+    CHECK(r.draw("8") == 1);
+    CHECK(canvas[0] == 0x18 && canvas[1] == 0);
+    CHECK(guards_intact());
+
+    r.position(0, 7);
+    r.draw("0123");
+    CHECK(guards_intact());
+}
+
+int main() {
+    test_first_draw_leaves_right_side_alone();
+    test_clips_pages_and_columns();
+    std::printf("number_renderer: ok\n");
+    return 0;
+}
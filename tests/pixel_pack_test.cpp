@@ -0,0 +1,74 @@
+#include "pixel_pack.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+static uint32_t seed = 12345;
+
+static uint8_t next_pixel() {
+    seed = seed * 1103515245u + 12345u;
+    // Mostly the extremes and a spread of midtones, like antialiased edges.
+    switch ((seed >> 16) & 3) {
+        case 0:
+            return 0;
+        case 1:
+            return 255;
+        default:
+            return (uint8_t) (seed >> 24);
+    }
+}
+
+// The vector path handles 16 pixels at a time and leaves the tail to the scalar
+// loop, so widths around multiples of 16 cover both and the boundary between them.
+static void test_matches_scalar(int bpp, bool dither) {
+    uint8_t src[80];
+    uint8_t simd[48];
+    uint8_t scalar[48];
+    for (int width = 0; width <= 80; width++) {
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < width; x++) {
+                src[x] = next_pixel();
+            }
+
+            auto thresholds = dither_row(y, dither);
+            std::memset(simd, 0xAA, sizeof(simd));
+            std::memset(scalar, 0x55, sizeof(scalar));
+            pack_row(src, width, bpp, thresholds, simd);
+            pack_row_scalar(src, width, bpp, thresholds, scalar);
+
+            const int bytes = (width * bpp + 7) >> 3;
+            CHECK(std::memcmp(simd, scalar, bytes) == 0);
+            CHECK(simd[bytes] == 0xAA);
+        }
+    }
+}
+
+static void test_levels() {
+    // 0, 1/3, 2/3 and full coverage map to the four 2bpp levels without dither.
+    const uint8_t src[4] = {0, 85, 170, 255};
+    uint8_t out[1];
+    pack_row(src, 4, 2, dither_row(0, false), out);
+    CHECK(out[0] == 0x1B);
+    pack_row_scalar(src, 4, 2, dither_row(0, false), out);
+    CHECK(out[0] == 0x1B);
+}
+
+int main() {
+    const int depths[] = {1, 2, 4};
+    for (int bpp : depths) {
+        test_matches_scalar(bpp, false);
+        test_matches_scalar(bpp, true);
+    }
+    test_levels();
+    std::printf("pixel_pack: ok\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "simulator.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+// 128x64 page canvas, like the SH1106 adapter.
+class page_graphics {
+public:
+    using pixel_type = uint8_t;
+
+    explicit page_graphics(uint8_t *canvas)
+        : buffer(canvas) {}
+
+    void pixel(int x, int y, pixel_type c) {
+        uint8_t mask = 1 << (y & 7);
+        buffer[x + (y >> 3) * 128] = c ? buffer[x + (y >> 3) * 128] | mask : buffer[x + (y >> 3) * 128] & ~mask;
+    }
+
+    void clear(pixel_type c) {
+        for (size_t i = 0; i < simulator::canvas_size; i++) {
+            buffer[i] = c ? 0xFF : 0;
+        }
+    }
+
+private:
+    uint8_t *buffer;
+};
+
+// Redraws the same 10 pixels twice on the first frame and on every press;
+// other ticks draw nothing.
+class overdraw_screen {
+public:
+    uint32_t operator()(uint8_t *canvas, input_event event) {
+        if (drawn && event != input_event::press) {
+            return 0;
+        }
+
+        drawn = true;
+        page_graphics target(canvas);
+        counting_graphics<page_graphics> g(&target);
+        for (int pass = 0; pass < 2; pass++) {
+            for (int x = 0; x < 10; x++) {
+                g.pixel(x, 0, 1);
+            }
+        }
+        return g.writes();
+    }
+
+private:
+    bool drawn{false};
+};
+
+static void wait_ticks() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+}
+
+int main() {
+    simulator sim{overdraw_screen()};
+    sim.start(std::chrono::milliseconds(1));
+    wait_ticks();
+
+    // Idle ticks keep the stats of the last frame that drew something.
+    auto stats = sim.stats();
+    CHECK(stats.frame == 1);
+    CHECK(stats.pixels_touched == 20);
+    CHECK(sim.front()[0] == 1 && sim.front()[9] == 1 && sim.front()[10] == 0);
+
+    // Identical content drawn again still counts every write.
+    sim.post(input_event::press);
+    wait_ticks();
+    stats = sim.stats();
+    CHECK(stats.frame == 2);
+    CHECK(stats.pixels_touched == 20);
+
+    sim.stop();
+    std::printf("simulator: ok\n");
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "text_run_cache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            std::exit(1);                                                   \
+        }                                                                   \
+    } while (0)
+
+class mem_reader {
+public:
+    template<class T>
+    static inline const T &read_mem(const void *ptr) {
+        return *reinterpret_cast<const T *>(ptr);
+    }
+};
+
+class pixel_graphics {
+public:
+    using pixel_type = uint8_t;
+
+    void pixel(int x, int y, pixel_type c) {
+        if (x >= 0 && x < 64 && y >= 0 && y < 16) {
+            map[y][x] = c;
+        }
+        pixels++;
+    }
+
+    uint8_t map[16][64]{};
+    int pixels{0};
+};
+
+class bitmap_graphics : public pixel_graphics {
+public:
+    void bitmap(int x, int y, const uint8_t *bits, int width, int height, pixel_type c) {
+        const int bytes_per_row = (width + 7) >> 3;
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                if (bits[j * bytes_per_row + (i >> 3)] & (0x80 >> (i & 7))) {
+                    pixel(x + i, y + j, c);
+                }
+            }
+        }
+        bitmaps++;
+    }
+
+    int bitmaps{0};
+};
+
+// 'A'..'D': 4x4 glyphs with distinct patterns, advance 5.
+static const uint8_t bitmap[] = {
+        0xF0, 0x90, 0x90, 0xF0,
+        0x60, 0x60, 0x60, 0x60,
+        0xF0, 0x10, 0x80, 0xF0,
+        0x90, 0x60, 0x60, 0x90};
+
+static const zoal::text::glyph glyphs[] = {
+        {0, 4, 4, 5, 0, -4},
+        {4, 4, 4, 5, 0, -4},
+        {8, 4, 4, 5, 0, -4},
+        {12, 4, 4, 5, 0, -4}};
+
+static const zoal::text::unicode_range ranges[] = {{'A', 'D', 0}};
+
+static const zoal::text::font font{8, bitmap, glyphs, 4, ranges, 1, nullptr, 0, 1};
+static const zoal::text::font font_2bpp{8, bitmap, glyphs, 4, ranges, 1, nullptr, 0, 2};
+
+// AB -1, CB -1, DA -2 as a pair table and as the equivalent class matrix.
+static const zoal::text::kerning_pair pairs[] = {{'A', 'B', -1}, {'C', 'B', -1}, {'D', 'A', -2}};
+static const uint8_t kern_left[] = {1, 0, 1, 2};
+static const uint8_t kern_right[] = {2, 1, 0, 0};
+static const int8_t kern_matrix[] = {
+        0, 0, 0,
+        0, -1, 0,
+        0, 0, -2};
+static const zoal::text::kerning_classes classes{kern_left, kern_right, kern_matrix, 3, 3};
+
+static const zoal::text::font font_pairs{8, bitmap, glyphs, 4, ranges, 1, pairs, 3, 1};
+static const zoal::text::font font_classes{8, bitmap, glyphs, 4, ranges, 1, nullptr, 0, 1};
+
+template<class Graphics>
+static void test_hit_and_miss() {
+    Graphics direct;
+    Graphics cached;
+    zoal::gfx::text_run_cache<Graphics, mem_reader, 2, 8, 64> cache(&cached);
+
+    CHECK(cache.draw(&font, L"ABC", 1, 0, 8) == 15);
+    CHECK(cache.hits() == 0 && cache.misses() == 1);
+    CHECK(cache.draw(&font, L"ABC", 1, 20, 8) == 15);
+    CHECK(cache.hits() == 1 && cache.misses() == 1);
+
+    // A different color is a different run.
+    cache.draw(&font, L"ABC", 2, 40, 8);
+    CHECK(cache.misses() == 2);
+
+    zoal::gfx::text_run_cache<Graphics, mem_reader, 2, 8, 64> reference(&direct);
+    reference.draw(&font, L"ABC", 1, 0, 8);
+    reference.draw(&font, L"ABC", 1, 20, 8);
+    reference.draw(&font, L"ABC", 2, 40, 8);
+    CHECK(std::memcmp(direct.map, cached.map, sizeof(direct.map)) == 0);
+}
+
+static void test_single_blit() {
+    bitmap_graphics g;
+    zoal::gfx::text_run_cache<bitmap_graphics, mem_reader, 2, 8, 64> cache(&g);
+    cache.draw(&font, L"AB", 1, 0, 8);
+    cache.draw(&font, L"AB", 1, 0, 8);
+    CHECK(g.bitmaps == 2);
+    CHECK(cache.hits() == 1);
+}
+
+static void test_eviction() {
+    pixel_graphics g;
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64> cache(&g);
+    cache.draw(&font, L"A", 1, 0, 8);
+    cache.draw(&font, L"B", 1, 0, 8);
+    cache.draw(&font, L"A", 1, 0, 8);
+    CHECK(cache.hits() == 1);
+
+    // "B" is the least recently used run and makes room for "C".
+    cache.draw(&font, L"C", 1, 0, 8);
+    cache.draw(&font, L"A", 1, 0, 8);
+    CHECK(cache.hits() == 2);
+    cache.draw(&font, L"B", 1, 0, 8);
+    CHECK(cache.hits() == 2 && cache.misses() == 4);
+}
+
+static void test_oversized() {
+    pixel_graphics direct;
+    pixel_graphics cached;
+    // 8 bytes fit "AB" (9x4 px) but not "ABCD" (19x4 px, 12 bytes).
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 8> cache(&cached);
+    CHECK(cache.draw(&font, L"ABCD", 1, 0, 8) == 20);
+    CHECK(cache.oversized() == 1);
+    CHECK(cache.draw(&font, L"ABCD", 1, 0, 8) == 20);
+    CHECK(cache.hits() == 1 && cache.oversized() == 1);
+
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64> reference(&direct);
+    reference.draw(&font, L"ABCD", 1, 0, 8);
+    CHECK(std::memcmp(direct.map, cached.map, sizeof(direct.map)) == 0);
+
+    // Longer than MaxChars: drawn directly, never cached.
+    CHECK(cache.draw(&font, L"ABCDABCDA", 1, 0, 8) == 45);
+    CHECK(cache.oversized() == 1);
+}
+
+static void test_antialiased_direct() {
+    pixel_graphics g;
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64> cache(&g);
+    // 'A' read as 2bpp: rows 0xF0, 0x90 are levels 3 3 0 0 and 2 1 0 0.
+    CHECK(cache.draw(&font_2bpp, L"AB", 3, 0, 8) == 10);
+    CHECK(g.map[4][0] == 3 && g.map[4][1] == 3 && g.map[4][2] == 0);
+    CHECK(g.map[5][0] == 2 && g.map[5][1] == 1);
+    CHECK(cache.hits() == 0 && cache.misses() == 0);
+
+    // Level 0 is transparent.
+    pixel_graphics blank;
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64> other(&blank);
+    other.draw(&font_2bpp, L"A", 3, 0, 8);
+    CHECK(blank.pixels == 8);
+}
+
+static void test_kerning_classes() {
+    pixel_graphics with_pairs;
+    pixel_graphics with_classes;
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64, 1> pair_cache(&with_pairs);
+    zoal::gfx::text_run_cache<pixel_graphics, mem_reader, 2, 8, 64, 1> class_cache(&with_classes);
+    CHECK(pair_cache.draw(&font_pairs, L"ABCBDA", 1, 0, 8) == 26);
+
+    // Unregistered, the class font has no kerning at all.
+    CHECK(class_cache.draw(&font_classes, L"ABCBDA", 1, 0, 8) == 30);
+    CHECK(class_cache.use_kerning_classes(&font_classes, &classes));
+    CHECK(!class_cache.use_kerning_classes(&font_pairs, &classes));
+    std::memset(with_classes.map, 0, sizeof(with_classes.map));
+    CHECK(class_cache.draw(&font_classes, L"ABCBDA", 1, 0, 8) == 26);
+    CHECK(class_cache.misses() == 2);
+    CHECK(std::memcmp(with_pairs.map, with_classes.map, sizeof(with_pairs.map)) == 0);
+
+    CHECK(class_cache.use_kerning_classes(&font_classes, nullptr));
+    CHECK(class_cache.draw(&font_classes, L"ABCBDA", 1, 0, 8) == 30);
+}
+
+int main() {
+    test_hit_and_miss<pixel_graphics>();
+    test_hit_and_miss<bitmap_graphics>();
+    test_single_blit();
+    test_eviction();
+    test_oversized();
+    test_antialiased_direct();
+    test_kerning_classes();
+    std::printf("text_run_cache: ok\n");
+    return 0;
+}
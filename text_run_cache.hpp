@@ -0,0 +1,414 @@
+#ifndef ZOAL_FONT_GENERATOR_TEXT_RUN_CACHE_HPP
+#define ZOAL_FONT_GENERATOR_TEXT_RUN_CACHE_HPP
+
+#include "kerning_classes.hpp"
+#include "types.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zoal {
+    namespace gfx {
+        // Keeps pre-composited bitmaps of recently drawn text runs, keyed by
+        // (font, text, color). A hit blits the stored bitmap without range lookup,
+        // kerning search or per-glyph decoding: in one call when Graphics provides
+        // bitmap(x, y, bits, width, height, color) for 1bpp MSB-first rows, and
+        // pixel by pixel otherwise. Storage is fixed-size; runs longer than MaxChars
+        // are drawn directly, and runs whose bitmap exceeds BitmapBytes are
+        // remembered as oversized and drawn directly without being measured again.
+        // Only 1bpp runs are cached; 2bpp/4bpp fonts are always drawn directly, their
+        // levels blended from 0 to the text color like glyph_render does.
+        // Fonts generated with --kern-classes are registered with
+        // use_kerning_classes(), up to ClassFonts of them.
+        template<class Graphics, class Reader, size_t Capacity = 8, size_t MaxChars = 24, size_t BitmapBytes = 256, size_t ClassFonts = 2>
+        class text_run_cache {
+        public:
+            using self_type = text_run_cache<Graphics, Reader, Capacity, MaxChars, BitmapBytes, ClassFonts>;
+            using pixel_type = typename Graphics::pixel_type;
+
+            explicit text_run_cache(Graphics *g) : graphics_(g) {
+                clear();
+            }
+
+            // Draws text with the pen at (x, y); returns the pen advance in pixels.
+            int draw(const zoal::text::font *font, const wchar_t *text, pixel_type color, int x, int y) {
+                if (font->bits_per_pixel > 1) {
+                    return draw_direct(font, text, color, x, y);
+                }
+
+                size_t length = 0;
+                while (text[length]) {
+                    length++;
+                }
+
+                run *r = find(font, text, length, color);
+                if (r != nullptr) {
+                    hits_++;
+                    r->used = ++tick_;
+                    if (r->oversized) {
+                        return draw_direct(font, text, color, x, y);
+                    }
+
+                    blit(r, x, y);
+                    return r->advance;
+                }
+
+                misses_++;
+                if (length > MaxChars) {
+                    return draw_direct(font, text, color, x, y);
+                }
+
+                r = victim();
+                if (!compose(r, font, text, length, color)) {
+                    return draw_direct(font, text, color, x, y);
+                }
+
+                blit(r, x, y);
+                return r->advance;
+            }
+
+            void clear() {
+                for (size_t i = 0; i < Capacity; i++) {
+                    runs_[i].valid = false;
+                }
+            }
+
+            // Looks kerning of font up in the class matrix k instead of its
+            // kerning_pairs; k == nullptr goes back to the pairs. Cached runs of
+            // the font are dropped. Returns false when all slots are taken.
+            bool use_kerning_classes(const zoal::text::font *font, const zoal::text::kerning_classes *k) {
+                class_font *slot = nullptr;
+                for (size_t i = 0; i < ClassFonts; i++) {
+                    if (class_fonts_[i].font == font) {
+                        slot = class_fonts_ + i;
+                        break;
+                    }
+
+                    if (slot == nullptr && class_fonts_[i].font == nullptr) {
+                        slot = class_fonts_ + i;
+                    }
+                }
+
+                if (slot == nullptr) {
+                    return false;
+                }
+
+                slot->font = k != nullptr ? font : nullptr;
+                slot->classes = k;
+                for (size_t i = 0; i < Capacity; i++) {
+                    runs_[i].valid = runs_[i].valid && runs_[i].font != font;
+                }
+                return true;
+            }
+
+            void reset_stats() {
+                hits_ = 0;
+                misses_ = 0;
+            }
+
+            uint32_t hits() const {
+                return hits_;
+            }
+
+            uint32_t misses() const {
+                return misses_;
+            }
+
+            uint32_t oversized() const {
+                uint32_t count = 0;
+                for (size_t i = 0; i < Capacity; i++) {
+                    count += runs_[i].valid && runs_[i].oversized ? 1 : 0;
+                }
+                return count;
+            }
+
+        private:
+            struct run {
+                const zoal::text::font *font;
+                pixel_type color;
+                uint16_t length;
+                wchar_t text[MaxChars];
+                int16_t left;
+                int16_t top;
+                int16_t advance;
+                uint8_t width;
+                uint8_t height;
+                uint32_t used;
+                bool valid;
+                bool oversized;
+                uint8_t bitmap[BitmapBytes];
+            };
+
+            struct class_font {
+                const zoal::text::font *font;
+                const zoal::text::kerning_classes *classes;
+            };
+
+            run *find(const zoal::text::font *font, const wchar_t *text, size_t length, pixel_type color) {
+                for (size_t i = 0; i < Capacity; i++) {
+                    run *r = runs_ + i;
+                    if (!r->valid || r->font != font || r->color != color || r->length != length) {
+                        continue;
+                    }
+
+                    size_t k = 0;
+                    while (k < length && r->text[k] == text[k]) {
+                        k++;
+                    }
+
+                    if (k == length) {
+                        return r;
+                    }
+                }
+                return nullptr;
+            }
+
+            run *victim() {
+                run *result = runs_;
+                for (size_t i = 0; i < Capacity; i++) {
+                    run *r = runs_ + i;
+                    if (!r->valid) {
+                        return r;
+                    }
+
+                    if (r->used < result->used) {
+                        result = r;
+                    }
+                }
+                return result;
+            }
+
+            static int glyph_index(const zoal::text::font *font, wchar_t ch) {
+                auto code = (uint16_t) ch;
+                for (int i = 0; i < font->ranges_count; i++) {
+                    const zoal::text::unicode_range *r = font->ranges + i;
+                    if (r->start <= code && code <= r->end) {
+                        return code - r->start + r->base;
+                    }
+                }
+                return -1;
+            }
+
+            static const zoal::text::glyph *find_glyph(const zoal::text::font *font, wchar_t ch) {
+                int index = glyph_index(font, ch);
+                return index < 0 ? nullptr : font->glyphs + index;
+            }
+
+            int kerning(const zoal::text::font *font, wchar_t first, wchar_t second) const {
+                for (size_t i = 0; i < ClassFonts; i++) {
+                    if (class_fonts_[i].font == font) {
+                        int a = glyph_index(font, first);
+                        int b = glyph_index(font, second);
+                        return a < 0 || b < 0 ? 0 : zoal::text::class_kerning<Reader>(class_fonts_[i].classes, a, b);
+                    }
+                }
+
+                auto f = (uint16_t) first;
+                auto s = (uint16_t) second;
+                int l = 0;
+                int r = font->kerning_pairs_count;
+                while (l < r) {
+                    int m = l + (r - l) / 2;
+                    auto &kp = Reader::template read_mem<zoal::text::kerning_pair>(font->kerning_pairs + m);
+                    if (kp.first < f || (kp.first == f && kp.second < s)) {
+                        l = m + 1;
+                    } else {
+                        r = m;
+                    }
+                }
+
+                if (l < font->kerning_pairs_count) {
+                    auto &kp = Reader::template read_mem<zoal::text::kerning_pair>(font->kerning_pairs + l);
+                    if (kp.first == f && kp.second == s) {
+                        return kp.x_advance;
+                    }
+                }
+                return 0;
+            }
+
+            bool compose(run *r, const zoal::text::font *font, const wchar_t *text, size_t length, pixel_type color) {
+                int min_x = 0x7FFF, min_y = 0x7FFF, max_x = -0x7FFF, max_y = -0x7FFF;
+                int pen = 0;
+                for (size_t i = 0; i < length; i++) {
+                    auto ptr = find_glyph(font, text[i]);
+                    if (ptr == nullptr) {
+                        continue;
+                    }
+
+                    if (i > 0) {
+                        pen += kerning(font, text[i - 1], text[i]);
+                    }
+
+                    auto &g = Reader::template read_mem<zoal::text::glyph>(ptr);
+                    if (g.width > 0 && g.height > 0) {
+                        min_x = pen + g.x_offset < min_x ? pen + g.x_offset : min_x;
+                        min_y = g.y_offset < min_y ? g.y_offset : min_y;
+                        max_x = pen + g.x_offset + g.width > max_x ? pen + g.x_offset + g.width : max_x;
+                        max_y = g.y_offset + g.height > max_y ? g.y_offset + g.height : max_y;
+                    }
+                    pen += g.x_advance;
+                }
+
+                if (max_x < min_x) {
+                    min_x = max_x = min_y = max_y = 0;
+                }
+
+                int width = max_x - min_x;
+                int height = max_y - min_y;
+                int bytes_per_row = (width + 7) >> 3;
+                r->valid = true;
+                r->font = font;
+                r->color = color;
+                r->length = (uint16_t) length;
+                r->used = ++tick_;
+                for (size_t i = 0; i < length; i++) {
+                    r->text[i] = text[i];
+                }
+
+                r->oversized = width > 0xFF || height > 0xFF || (size_t) (bytes_per_row * height) > BitmapBytes;
+                if (r->oversized) {
+                    return false;
+                }
+
+                r->left = (int16_t) min_x;
+                r->top = (int16_t) min_y;
+                r->advance = (int16_t) pen;
+                r->width = (uint8_t) width;
+                r->height = (uint8_t) height;
+                for (int i = 0; i < bytes_per_row * height; i++) {
+                    r->bitmap[i] = 0;
+                }
+
+                pen = 0;
+                for (size_t i = 0; i < length; i++) {
+                    auto ptr = find_glyph(font, text[i]);
+                    if (ptr == nullptr) {
+                        continue;
+                    }
+
+                    if (i > 0) {
+                        pen += kerning(font, text[i - 1], text[i]);
+                    }
+
+                    auto &g = Reader::template read_mem<zoal::text::glyph>(ptr);
+                    const uint8_t *data = font->bitmap + g.bitmap_offset;
+                    const int glyph_bytes = (g.width + 7) >> 3;
+                    const int dx = pen + g.x_offset - min_x;
+                    const int dy = g.y_offset - min_y;
+                    for (int y = 0; y < g.height; y++) {
+                        auto row = data + y * glyph_bytes;
+                        auto dst = r->bitmap + (dy + y) * bytes_per_row;
+                        for (int x = 0; x < g.width; x++) {
+                            if (Reader::template read_mem<uint8_t>(row + (x >> 3)) & (0x80 >> (x & 7))) {
+                                int px = dx + x;
+                                dst[px >> 3] |= 0x80 >> (px & 7);
+                            }
+                        }
+                    }
+                    pen += g.x_advance;
+                }
+
+                return true;
+            }
+
+            // Picks the bitmap() overload when Graphics has one.
+            template<class G>
+            static auto blit_bitmap(G *g, const run *r, int x, int y, int)
+                -> decltype(g->bitmap(x, y, r->bitmap, r->width, r->height, r->color), void()) {
+                g->bitmap(x + r->left, y + r->top, r->bitmap, r->width, r->height, r->color);
+            }
+
+            template<class G>
+            static void blit_bitmap(G *g, const run *r, int x, int y, long) {
+                blit_pixels(g, r, x, y);
+            }
+
+            void blit(const run *r, int x, int y) {
+                blit_bitmap(graphics_, r, x, y, 0);
+            }
+
+            static void blit_pixels(Graphics *graphics, const run *r, int x, int y) {
+                const int bytes_per_row = (r->width + 7) >> 3;
+                const int left = x + r->left;
+                const int top = y + r->top;
+                for (int j = 0; j < r->height; j++) {
+                    auto row = r->bitmap + j * bytes_per_row;
+                    for (int b = 0; b < bytes_per_row; b++) {
+                        uint8_t bits = row[b];
+                        for (int k = 0; bits != 0; k++, bits <<= 1) {
+                            if (bits & 0x80) {
+                                graphics->pixel(left + (b << 3) + k, top + j, r->color);
+                            }
+                        }
+                    }
+                }
+            }
+
+            int draw_direct(const zoal::text::font *font, const wchar_t *text, pixel_type color, int x, int y) {
+                int pen = 0;
+                for (size_t i = 0; text[i]; i++) {
+                    auto ptr = find_glyph(font, text[i]);
+                    if (ptr == nullptr) {
+                        continue;
+                    }
+
+                    if (i > 0) {
+                        pen += kerning(font, text[i - 1], text[i]);
+                    }
+
+                    auto &g = Reader::template read_mem<zoal::text::glyph>(ptr);
+                    if (font->bits_per_pixel > 1) {
+                        draw_levels(font, g, color, x + pen, y);
+                        pen += g.x_advance;
+                        continue;
+                    }
+
+                    const uint8_t *data = font->bitmap + g.bitmap_offset;
+                    const int glyph_bytes = (g.width + 7) >> 3;
+                    for (int j = 0; j < g.height; j++) {
+                        auto row = data + j * glyph_bytes;
+                        for (int k = 0; k < g.width; k++) {
+                            if (Reader::template read_mem<uint8_t>(row + (k >> 3)) & (0x80 >> (k & 7))) {
+                                graphics_->pixel(x + pen + g.x_offset + k, y + g.y_offset + j, color);
+                            }
+                        }
+                    }
+                    pen += g.x_advance;
+                }
+                return pen;
+            }
+
+            // Level 0 is transparent, the others are blended between 0 and color.
+            void draw_levels(const zoal::text::font *font, const zoal::text::glyph &g, pixel_type color, int x, int y) {
+                const int bpp = font->bits_per_pixel;
+                const int max_level = (1 << bpp) - 1;
+                pixel_type blend[16];
+                for (int l = 0; l <= max_level; l++) {
+                    blend[l] = (pixel_type) ((int) color * l / max_level);
+                }
+
+                const uint8_t *data = font->bitmap + g.bitmap_offset;
+                const int bytes_per_row = (g.width * bpp + 7) >> 3;
+                for (int j = 0; j < g.height; j++) {
+                    auto row = data + j * bytes_per_row;
+                    for (int k = 0; k < g.width; k++) {
+                        int bit = k * bpp;
+                        int level = (Reader::template read_mem<uint8_t>(row + (bit >> 3)) >> (8 - bpp - (bit & 7))) & max_level;
+                        if (level != 0) {
+                            graphics_->pixel(x + g.x_offset + k, y + g.y_offset + j, blend[level]);
+                        }
+                    }
+                }
+            }
+
+            Graphics *graphics_;
+            run runs_[Capacity];
+            class_font class_fonts_[ClassFonts]{};
+            uint32_t tick_{0};
+            uint32_t hits_{0};
+            uint32_t misses_{0};
+        };
+    }
+}
+
+#endif
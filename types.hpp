@@ -3,6 +3,14 @@
 
 #include <stdint.h>
 
+// Superset of <zoal/text/types.hpp> as shipped by zoal, which has no
+// font::bits_per_pixel and none of the types below the font. Generated headers
+// include the zoal header and then define whatever of the extension types they
+// need under the same ZOAL_TEXT_* guards, so output from this generator builds
+// against stock zoal as well as against this file. Antialiased (--bpp 2/4) output
+// needs font::bits_per_pixel and therefore this file in place of zoal's.
+#define ZOAL_TEXT_FONT_BITS_PER_PIXEL
+
 namespace zoal { namespace text {
     typedef struct {
         uint32_t bitmap_offset;
@@ -34,7 +42,51 @@ namespace zoal { namespace text {
         uint16_t ranges_count;
         const kerning_pair *kerning_pairs;
         uint16_t kerning_pairs_count;
+        uint8_t bits_per_pixel;
     } font;
+
+#ifndef ZOAL_TEXT_DIGIT_STRIP
+#define ZOAL_TEXT_DIGIT_STRIP
+    // Fixed-advance cells for "0123456789.-:%" in SH1106 page layout: every cell
+    // is `pages` rows of `advance` column bytes, bit 0 being the topmost pixel.
+    typedef struct {
+        uint8_t advance;
+        uint8_t pages;
+        int8_t y_offset;
+        const uint8_t *bitmap;
+    } digit_strip;
+#endif
+
+#ifndef ZOAL_TEXT_KERNING_CLASSES
+#define ZOAL_TEXT_KERNING_CLASSES
+    // Kerning of glyphs a, b is matrix[left[a] * right_count + right[b]].
+    typedef struct {
+        const uint8_t *left;
+        const uint8_t *right;
+        const int8_t *matrix;
+        uint8_t left_count;
+        uint8_t right_count;
+    } kerning_classes;
+#endif
+
+#ifndef ZOAL_TEXT_PACKED_FONT
+#define ZOAL_TEXT_PACKED_FONT
+    // Whole font compressed with GenFont --lz. The payload holds glyphs_count
+    // 9-byte descriptors (u32 bitmap offset, width, height, x advance, x offset,
+    // y offset; little-endian) followed by bitmap_size bytes of bitmap.
+    typedef struct {
+        uint8_t y_advance;
+        uint8_t bits_per_pixel;
+        const uint8_t *data;
+        uint32_t data_size;
+        uint32_t bitmap_size;
+        uint16_t glyphs_count;
+        const unicode_range *ranges;
+        uint16_t ranges_count;
+        const kerning_pair *kerning_pairs;
+        uint16_t kerning_pairs_count;
+    } packed_font;
+#endif
 }}
 
 #endif